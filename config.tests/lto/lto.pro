@@ -0,0 +1,3 @@
+SOURCES = test.cpp
+QMAKE_CXXFLAGS += -flto
+QMAKE_LFLAGS += -flto -fuse-ld=gold
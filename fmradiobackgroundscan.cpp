@@ -0,0 +1,506 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiobackgroundscan.h"
+#include "fmradiometadata.h"
+#include "fmradiostationcache.h"
+#include "fmradiotracelog.h"
+
+#include <QLoggingCategory>
+
+#include <system/radio_metadata.h>
+
+#include <string.h>
+
+Q_DECLARE_LOGGING_CATEGORY(log)
+
+#define BACKGROUND_INTERVAL_MS      10000
+#define BACKGROUND_TUNE_TIMEOUT_MS  3000
+#define BACKGROUND_SCAN_TIMEOUT_MS  10000
+// Checks in a row a station must be missing before it is removed, a
+// car may just be passing under a bridge.
+#define BACKGROUND_MISS_LIMIT       2
+
+FMRadioBackgroundScan::FMRadioBackgroundScan(FMRadioStationCache *stations)
+    : QObject()
+    , m_stations(stations)
+    , m_timer(new QTimer(this))
+    , m_stationIdTimeout(0)
+    , m_device(0)
+    , m_tuner(0)
+    , m_active(false)
+    , m_opening(false)
+    , m_ready(false)
+    , m_state(Idle)
+    , m_probeChannel(0)
+    , m_probeTuned(false)
+    , m_probeSignalStrength(0)
+    , m_probeStereo(false)
+    , m_passIndex(0)
+    , m_scanPending(false)
+    , m_scanChannel(0)
+{
+    memset(&m_config, 0, sizeof(m_config));
+
+    bool ok;
+    int interval = qgetenv("HALRADIO_BACKGROUND_INTERVAL_MS").toInt(&ok);
+    m_interval = ok && interval > 0 ? interval : BACKGROUND_INTERVAL_MS;
+
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(handleTimeout()));
+
+    connect(&m_worker, SIGNAL(commandFinished(int, int, unsigned, qint64)),
+            this, SLOT(handleCommandFinished(int, int, unsigned, qint64)));
+    connect(&m_worker, SIGNAL(tunerOpened(int, void*, qint64)),
+            this, SLOT(handleTunerOpened(int, void*, qint64)));
+}
+
+FMRadioBackgroundScan::~FMRadioBackgroundScan()
+{
+    close();
+    m_worker.stop();
+}
+
+bool FMRadioBackgroundScan::isSupported(const radio_hal_properties_t &properties)
+{
+    return properties.num_tuners >= 2;
+}
+
+// Worker thread is started only when background scan is first used
+void FMRadioBackgroundScan::start(struct radio_hw_device *device, const radio_hal_band_config_t &config,
+                                  int stationIdTimeout)
+{
+    m_stationIdTimeout = stationIdTimeout;
+
+    if (m_active)
+        return;
+
+    if (!m_worker.isRunning())
+        m_worker.start();
+
+    m_active = true;
+    m_device = device;
+    m_config = config;
+    m_ready = false;
+    m_state = Idle;
+    m_pass.clear();
+    m_passIndex = 0;
+    m_scanPending = false;
+    m_scanChannel = config.lower_limit;
+
+    // Stopped and started again before the tuner was opened
+    if (m_opening)
+        return;
+
+    qCDebug(log) << "Start background scan every" << m_interval << "ms.";
+
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::OpenTuner, 0);
+    command.time = FMRadioTraceLog::now();
+    command.device = m_device;
+    command.config = m_config;
+    command.audio = false;
+    command.callback = &FMRadioBackgroundScan::radioEventCallback;
+    command.cookie = this;
+    m_worker.post(command);
+
+    m_opening = true;
+}
+
+void FMRadioBackgroundScan::stop()
+{
+    if (!m_active)
+        return;
+
+    qCDebug(log) << "Stop background scan.";
+
+    m_active = false;
+    m_timer->stop();
+    m_state = Idle;
+    m_misses.clear();
+    m_removed.clear();
+
+    if (m_tuner) {
+        FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::CloseTuner, m_tuner);
+        command.device = m_device;
+        m_worker.post(command);
+        m_tuner = 0;
+    }
+}
+
+bool FMRadioBackgroundScan::isActive() const
+{
+    return m_active;
+}
+
+void FMRadioBackgroundScan::close()
+{
+    stop();
+
+    if (!m_device)
+        return;
+
+    // Tuner open still in progress is not reported anymore
+    m_worker.flush();
+    if (const struct radio_tuner *tuner = m_worker.openTuner()) {
+        FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::CloseTuner, tuner);
+        command.device = m_device;
+        m_worker.post(command);
+        m_worker.flush();
+    }
+    m_opening = false;
+    m_device = 0;
+}
+
+void FMRadioBackgroundScan::handleTunerOpened(int result, void *tuner, qint64)
+{
+    if (!m_opening)
+        return;
+
+    m_opening = false;
+
+    if (result != 0) {
+        qCWarning(log) << "Failed to open background tuner:" << result;
+        m_active = false;
+        return;
+    }
+
+    m_tuner = static_cast<const struct radio_tuner*>(tuner);
+
+    if (!m_active) {
+        m_active = true;
+        stop();
+        return;
+    }
+
+    m_timer->start(m_interval);
+}
+
+void FMRadioBackgroundScan::handleCommandFinished(int type, int result, unsigned channel, qint64)
+{
+    if (result == 0 || !m_tuner)
+        return;
+
+    if ((type == FMRadioCommand::Tune && m_state == Checking && channel == m_probeChannel)
+        || (type == FMRadioCommand::Tune && m_state == Positioning)
+        || (type == FMRadioCommand::Scan && m_state == Scanning)) {
+        qCDebug(log) << "Background" << (type == FMRadioCommand::Scan ? "scan" : "tune") << "failed:" << result;
+        finishProbe();
+    }
+}
+
+void FMRadioBackgroundScan::post(int type, unsigned channel)
+{
+    FMRadioCommand command = FMRadioWorker::command(type, m_tuner);
+    command.channel = channel;
+    command.direction = RADIO_DIRECTION_UP;
+    m_worker.post(command);
+}
+
+void FMRadioBackgroundScan::handleTimeout()
+{
+    if (!m_tuner)
+        return;
+
+    switch (m_state) {
+        case Idle:
+            if (m_ready)
+                nextProbe();
+            else
+                m_timer->start(m_interval);
+            break;
+
+        case WaitingStationId:
+            // Station is there, but without RDS or it is too weak
+            probeDone();
+            break;
+
+        default:
+            qCDebug(log) << "Background probe of channel" << m_probeChannel << "timed out.";
+            finishProbe();
+            break;
+    }
+}
+
+void FMRadioBackgroundScan::nextProbe()
+{
+    if (m_passIndex >= m_pass.size()) {
+        if (m_scanPending) {
+            m_scanPending = false;
+            startScanStep();
+            return;
+        }
+
+        startPass();
+
+        if (m_pass.isEmpty()) {
+            startScanStep();
+            return;
+        }
+    }
+
+    m_probeChannel = m_pass.at(m_passIndex++);
+    m_probeTuned = false;
+    m_state = Checking;
+    post(FMRadioCommand::Tune, m_probeChannel);
+    m_timer->start(BACKGROUND_TUNE_TIMEOUT_MS);
+}
+
+void FMRadioBackgroundScan::startPass()
+{
+    m_pass.clear();
+    m_passIndex = 0;
+
+    for (int i = 0; i < m_stations->count(); ++i)
+        m_pass.append(m_stations->at(i).frequency);
+
+    QSet<unsigned>::const_iterator i;
+    for (i = m_removed.constBegin(); i != m_removed.constEnd(); ++i)
+        m_pass.append(*i);
+
+    m_scanPending = !m_pass.isEmpty();
+}
+
+// Scan starts from the tuned channel, so first go back to where the
+// previous step found a station.
+void FMRadioBackgroundScan::startScanStep()
+{
+    m_state = Positioning;
+    post(FMRadioCommand::Tune, m_scanChannel);
+    m_timer->start(BACKGROUND_TUNE_TIMEOUT_MS);
+}
+
+void FMRadioBackgroundScan::handleTuned(unsigned channel, bool tuned, unsigned signalStrength, bool stereo)
+{
+    m_probeSignalStrength = qMin(signalStrength, 100u);
+    m_probeStereo = stereo;
+
+    switch (m_state) {
+        case Checking:
+            if (channel != m_probeChannel)
+                break;
+            m_probeTuned = tuned;
+            if (tuned)
+                waitStationId();
+            else
+                probeDone();
+            break;
+
+        case Positioning:
+            m_state = Scanning;
+            post(FMRadioCommand::Scan, 0);
+            m_timer->start(BACKGROUND_SCAN_TIMEOUT_MS);
+            break;
+
+        case Scanning:
+            if (!tuned) {
+                finishProbe();
+                break;
+            }
+            // HAL wraps around at the end of the band
+            m_scanChannel = channel > m_scanChannel ? channel : m_config.lower_limit;
+            m_probeChannel = channel;
+            m_probeTuned = true;
+            waitStationId();
+            break;
+
+        default: break;
+    }
+}
+
+void FMRadioBackgroundScan::waitStationId()
+{
+    m_stationId.clear();
+    m_stationName.clear();
+
+    if (m_config.fm.rds == RADIO_RDS_NONE) {
+        probeDone();
+        return;
+    }
+
+    m_state = WaitingStationId;
+    m_timer->start(m_stationIdTimeout);
+}
+
+void FMRadioBackgroundScan::handleMetadata(const radio_metadata_t *metadata, unsigned size)
+{
+    if (m_state != WaitingStationId)
+        return;
+
+    bool received = false;
+    FMRadioMetadataItem item;
+    FMRadioMetadataReader reader(metadata, size);
+
+    while (reader.next(item)) {
+        if (item.type != RADIO_METADATA_TYPE_TEXT)
+            continue;
+
+        const char *text = static_cast<const char*>(item.data);
+
+        if (item.key == RADIO_METADATA_KEY_RDS_PI) {
+            m_stationId.update(text, item.size);
+            received = m_stationId.length() > 0;
+        } else if (item.key == RADIO_METADATA_KEY_RDS_PS) {
+            m_stationName.update(text, item.size);
+        }
+    }
+
+    if (received)
+        probeDone();
+}
+
+// Station ids and names not received keep their cached values.
+void FMRadioBackgroundScan::probeDone()
+{
+    FMRadioStationCache::Locker locker(m_stations);
+    unsigned channel = m_probeChannel;
+    int index = m_stations->indexOf(channel);
+    QString stationId = m_stationId.toString();
+    QString stationName = m_stationName.toString();
+
+    finishProbe();
+
+    if (m_probeTuned) {
+        m_misses.remove(channel);
+
+        if (index >= 0) {
+            const FMRadioStation &station = m_stations->at(index);
+            QString cachedId = FMRadioStationCache::stationId(station);
+
+            if (stationId.isEmpty())
+                stationId = cachedId;
+            if (stationName.isEmpty())
+                stationName = FMRadioStationCache::stationName(station);
+
+            m_stations->update(channel, stationId, stationName, station.programType,
+                               m_probeSignalStrength, m_probeStereo, false);
+            if (stationId != cachedId) {
+                qCDebug(log) << "Background scan: channel" << channel << "changed to" << stationId;
+                emit stationChanged(channel, stationId);
+            }
+        } else if (m_stations->update(channel, stationId, stationName, 0,
+                                      m_probeSignalStrength, m_probeStereo, true)) {
+            qCDebug(log) << "Background scan: channel" << channel << "added" << stationId;
+            m_removed.remove(channel);
+            emit stationAdded(channel, stationId);
+        }
+    } else if (index >= 0 && ++m_misses[channel] >= BACKGROUND_MISS_LIMIT) {
+        qCDebug(log) << "Background scan: channel" << channel << "removed";
+        m_misses.remove(channel);
+        m_removed.insert(channel);
+        m_stations->remove(channel);
+        emit stationRemoved(channel);
+    }
+}
+
+void FMRadioBackgroundScan::finishProbe()
+{
+    m_state = Idle;
+    m_timer->start(m_interval);
+}
+
+void FMRadioBackgroundScan::handleEvents()
+{
+    FMRadioEvent event;
+
+    m_events.acknowledge();
+
+    while (m_events.pop(event)) {
+        switch (event.type) {
+            case RADIO_EVENT_HW_FAILURE:
+                if (m_tuner) {
+                    qCWarning(log) << "Background tuner failed, background scan stopped.";
+                    stop();
+                }
+                break;
+
+            case RADIO_EVENT_CONFIG:
+                m_ready = true;
+                break;
+
+            case RADIO_EVENT_TUNED:
+                if (m_tuner)
+                    handleTuned(event.channel, event.tuned, event.signalStrength, event.stereo);
+                break;
+
+            case RADIO_EVENT_METADATA:
+                if (m_tuner)
+                    handleMetadata(static_cast<const radio_metadata_t*>(m_metadata.data(event.metadata)),
+                                   m_metadata.size(event.metadata));
+                m_metadata.release(event.metadata);
+                break;
+
+            default: break;
+        }
+    }
+
+    m_events.takeDropped();
+}
+
+// Called in radio event callback thread
+void FMRadioBackgroundScan::radioEvent(const radio_hal_event_t *event)
+{
+    FMRadioEvent e;
+    unsigned metadataSize;
+
+    memset(&e, 0, sizeof(e));
+    e.time = FMRadioTraceLog::now();
+    e.type = event->type;
+    e.metadata = -1;
+
+    switch (event->type) {
+        case RADIO_EVENT_HW_FAILURE:
+        case RADIO_EVENT_CONFIG:
+            break;
+
+        case RADIO_EVENT_TUNED:
+            e.channel = event->info.channel;
+            e.tuned = event->info.tuned;
+            e.stereo = event->info.stereo;
+            e.signalStrength = event->info.signal_strength;
+            break;
+
+        case RADIO_EVENT_METADATA:
+            if (!(metadataSize = FMRadioMetadataReader::size(event->metadata))
+                || (e.metadata = m_metadata.acquire(event->metadata, metadataSize)) < 0)
+                return;
+            break;
+
+        // nothing else matters without audio
+        default: return;
+    }
+
+    bool wakeUp;
+
+    if (!m_events.push(e, &wakeUp)) {
+        if (e.metadata >= 0)
+            m_metadata.release(e.metadata);
+        return;
+    }
+
+    if (wakeUp)
+        QMetaObject::invokeMethod(this, "handleEvents", Qt::QueuedConnection);
+}
+
+// Called in radio event callback thread
+void FMRadioBackgroundScan::radioEventCallback(radio_hal_event_t *event, void *cookie)
+{
+    static_cast<FMRadioBackgroundScan*>(cookie)->radioEvent(event);
+}
@@ -0,0 +1,133 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOBACKGROUNDSCAN_H
+#define __FMRADIOBACKGROUNDSCAN_H
+
+#include "fmradioeventqueue.h"
+#include "fmradiordstext.h"
+#include "fmradioworker.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include <android-config.h>
+#include <hardware/radio.h>
+
+class FMRadioStationCache;
+
+// Keeps the station cache up to date with a second tuner, which has
+// no audio, while the first one keeps playing. One cached station is
+// tuned to every HALRADIO_BACKGROUND_INTERVAL_MS to see if it is still
+// there and has the same PI, and after every round one scan step looks
+// for new stations. Only the differences are reported.
+class FMRadioBackgroundScan : public QObject
+{
+    Q_OBJECT
+public:
+    FMRadioBackgroundScan(FMRadioStationCache *stations);
+    ~FMRadioBackgroundScan();
+
+    // HAL can have a tuner open besides the one playing.
+    static bool isSupported(const radio_hal_properties_t &properties);
+
+    // stationIdTimeout is how long to wait for PI, the searches use the
+    // same learned value.
+    void start(struct radio_hw_device *device, const radio_hal_band_config_t &config,
+               int stationIdTimeout);
+    void stop();
+    bool isActive() const;
+
+    // Stops and closes the tuner before the device is closed.
+    void close();
+
+signals:
+    // Frequencies in kHz
+    void stationAdded(unsigned frequency, const QString &stationId);
+    void stationRemoved(unsigned frequency);
+    void stationChanged(unsigned frequency, const QString &stationId);
+
+private slots:
+    void handleEvents();
+    void handleTimeout();
+    void handleCommandFinished(int type, int result, unsigned channel, qint64 time);
+    void handleTunerOpened(int result, void *tuner, qint64 time);
+
+private:
+    enum State {
+        Idle,
+        Checking,           // tuned to cached station, waiting for result
+        Positioning,        // tuned to where last scan step ended
+        Scanning,
+        WaitingStationId
+    };
+
+    void post(int type, unsigned channel);
+    void nextProbe();
+    void startPass();
+    void startScanStep();
+    void handleTuned(unsigned channel, bool tuned, unsigned signalStrength, bool stereo);
+    void handleMetadata(const radio_metadata_t *metadata, unsigned size);
+    void waitStationId();
+    void probeDone();
+    void finishProbe();
+
+    void radioEvent(const radio_hal_event_t *event);
+    static void radioEventCallback(radio_hal_event_t *event, void *cookie);
+
+    FMRadioStationCache *m_stations;
+    FMRadioWorker m_worker;
+    FMRadioEventQueue m_events;
+    FMRadioMetadataPool m_metadata;
+    QTimer *m_timer;
+    int m_interval;
+    int m_stationIdTimeout;
+
+    struct radio_hw_device *m_device;
+    const struct radio_tuner *m_tuner;
+    radio_hal_band_config_t m_config;
+    bool m_active;
+    bool m_opening;
+    bool m_ready;
+
+    State m_state;
+    unsigned m_probeChannel;
+    bool m_probeTuned;
+    int m_probeSignalStrength;
+    bool m_probeStereo;
+    FMRadioRdsText m_stationId;
+    FMRadioRdsText m_stationName;
+
+    // stations to check in this round
+    QVector<unsigned> m_pass;
+    int m_passIndex;
+    bool m_scanPending;
+    unsigned m_scanChannel;
+
+    // checks in a row a cached station was not found, and stations
+    // removed because of it, which are checked again for coming back
+    QHash<unsigned, int> m_misses;
+    QSet<unsigned> m_removed;
+};
+
+#endif
@@ -25,24 +25,21 @@ QT_BEGIN_NAMESPACE
 FMRadioDataControl::FMRadioDataControl(QObject *parent, FMRadioHalControl *ctrl)
    : QRadioDataControl(parent), control(ctrl)
 {
-    connect(control, SIGNAL(stationIdChanged(QString)),
-               this, SIGNAL(stationIdChanged(QString)));
-    connect(control, SIGNAL(programTypeChanged(QRadioData::ProgramType)),
-               this, SIGNAL(programTypeChanged(QRadioData::ProgramType)));
-    connect(control, SIGNAL(programTypeNameChanged(QString)),
-               this, SIGNAL(programTypeNameChanged(QString)));
-    connect(control, SIGNAL(stationNameChanged(QString)),
-               this, SIGNAL(stationNameChanged(QString)));
-    connect(control, SIGNAL(radioTextChanged(QString)),
-               this, SIGNAL(radioTextChanged(QString)));
+    connect(control, SIGNAL(rdsUpdated(FMRadioRdsData)),
+               this, SLOT(handleRdsUpdated(FMRadioRdsData)));
+    connect(control, SIGNAL(programTypeNamesChanged()),
+               this, SLOT(handleProgramTypeNamesChanged()));
     connect(control, SIGNAL(alternativeFrequenciesEnabledChanged(bool)),
                this, SIGNAL(alternativeFrequenciesEnabledChanged(bool)));
     connect(control, SIGNAL(error(QRadioData::Error)),
                this, SIGNAL(error(QRadioData::Error)));
+
+    control->addRdsClient(this);
 }
 
 FMRadioDataControl::~FMRadioDataControl()
 {
+    control->removeRdsClient(this);
 }
 
 bool FMRadioDataControl::isAvailable() const
@@ -100,4 +97,27 @@ QString FMRadioDataControl::errorString() const
     return control->rdsErrorString();
 }
 
+// One packet's RDS changes, emitted together
+void FMRadioDataControl::handleRdsUpdated(const FMRadioRdsData &rds)
+{
+    if (rds.changed & FMRadioRdsData::StationId)
+        emit stationIdChanged(rds.stationId);
+
+    if (rds.changed & FMRadioRdsData::ProgramType) {
+        emit programTypeChanged(rds.programType);
+        emit programTypeNameChanged(rds.programTypeName);
+    }
+
+    if (rds.changed & FMRadioRdsData::StationName)
+        emit stationNameChanged(rds.stationName);
+
+    if (rds.changed & FMRadioRdsData::RadioText)
+        emit radioTextChanged(rds.radioText);
+}
+
+void FMRadioDataControl::handleProgramTypeNamesChanged()
+{
+    emit programTypeNameChanged(control->programTypeName());
+}
+
 QT_END_NAMESPACE
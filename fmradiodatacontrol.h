@@ -49,6 +49,10 @@ public:
    QRadioData::Error error() const;
    QString errorString() const;
 
+private slots:
+    void handleRdsUpdated(const FMRadioRdsData &rds);
+    void handleProgramTypeNamesChanged();
+
 private:
     FMRadioHalControl *control;
 };
@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradioeventqueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+FMRadioEventQueue::FMRadioEventQueue()
+    : m_head(0)
+    , m_tail(0)
+    , m_pending(0)
+    , m_dropped(0)
+{
+}
+
+// Called in radio event callback thread
+bool FMRadioEventQueue::push(const FMRadioEvent &event, bool *wakeUp)
+{
+    unsigned head = m_head.load();
+
+    *wakeUp = false;
+
+    if (head - m_tail.loadAcquire() >= Capacity) {
+        m_dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    m_events[head & (Capacity - 1)] = event;
+    m_head.storeRelease(head + 1);
+
+    // Only the first event after the consumer has acknowledged
+    // previous batch needs to wake the consumer up.
+    *wakeUp = m_pending.testAndSetOrdered(0, 1);
+
+    return true;
+}
+
+void FMRadioEventQueue::acknowledge()
+{
+    m_pending.fetchAndStoreOrdered(0);
+}
+
+bool FMRadioEventQueue::pop(FMRadioEvent &event)
+{
+    unsigned tail = m_tail.load();
+
+    if (tail == m_head.loadAcquire())
+        return false;
+
+    event = m_events[tail & (Capacity - 1)];
+    m_tail.storeRelease(tail + 1);
+
+    return true;
+}
+
+int FMRadioEventQueue::takeDropped()
+{
+    return m_dropped.fetchAndStoreRelaxed(0);
+}
+
+FMRadioMetadataPool::FMRadioMetadataPool()
+{
+    for (int i = 0; i < SlotCount; ++i) {
+        m_size[i] = 0;
+        m_heap[i] = 0;
+        m_busy[i].store(0);
+    }
+}
+
+FMRadioMetadataPool::~FMRadioMetadataPool()
+{
+    for (int i = 0; i < SlotCount; ++i)
+        free(m_heap[i]);
+}
+
+// Called in radio event callback thread
+int FMRadioMetadataPool::acquire(const void *data, unsigned size)
+{
+    if (size == 0)
+        return -1;
+
+    for (int i = 0; i < SlotCount; ++i) {
+        if (m_busy[i].loadAcquire() == 0) {
+            // Slow path, only for packets that don't fit in a slot
+            if (size > SlotSize) {
+                if (!(m_heap[i] = malloc(size)))
+                    return -1;
+                memcpy(m_heap[i], data, size);
+            } else {
+                memcpy(m_data[i], data, size);
+            }
+            m_size[i] = size;
+            m_busy[i].storeRelease(1);
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+const void *FMRadioMetadataPool::data(int slot) const
+{
+    return m_heap[slot] ? m_heap[slot] : m_data[slot];
+}
+
+unsigned FMRadioMetadataPool::size(int slot) const
+{
+    return m_size[slot];
+}
+
+void FMRadioMetadataPool::release(int slot)
+{
+    free(m_heap[slot]);
+    m_heap[slot] = 0;
+    m_busy[slot].storeRelease(0);
+}
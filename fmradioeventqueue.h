@@ -0,0 +1,100 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOEVENTQUEUE_H
+#define __FMRADIOEVENTQUEUE_H
+
+#include <QAtomicInt>
+
+// Plain copy of the fields we use from radio_hal_event_t.
+struct FMRadioEvent {
+    qint64 time;    // FMRadioTraceLog::now() when received
+    int type;
+    int band;
+    unsigned channel;
+    unsigned signalStrength;
+    bool on;
+    bool stereo;
+    bool tuned;
+    int metadata; // FMRadioMetadataPool slot or -1
+};
+
+// Fixed size single-producer/single-consumer ring. The producer is the
+// HAL callback thread, the consumer is the thread owning the control.
+// push() and pop() never allocate or lock.
+class FMRadioEventQueue
+{
+public:
+    static const unsigned Capacity = 64; // must be power of two
+
+    FMRadioEventQueue();
+
+    // Producer side. Returns false if the queue is full. wakeUp is set
+    // to true if the consumer needs to be woken up, which happens only
+    // once per batch of events.
+    bool push(const FMRadioEvent &event, bool *wakeUp);
+
+    // Consumer side. Call acknowledge() before draining the queue with
+    // pop(), events pushed after that will request a new wake up.
+    void acknowledge();
+    bool pop(FMRadioEvent &event);
+
+    // Number of events dropped due to full queue since last call.
+    int takeDropped();
+
+private:
+    FMRadioEvent m_events[Capacity];
+    QAtomicInteger<unsigned> m_head;
+    QAtomicInteger<unsigned> m_tail;
+    QAtomicInt m_pending;
+    QAtomicInt m_dropped;
+};
+
+// Preallocated buffers for copying radio_metadata_t blobs out of the
+// HAL callback. Slots are acquired by the producer and released by the
+// consumer once the blob has been parsed. Blobs larger than SlotSize,
+// such as ones with an image, are copied to the heap instead.
+class FMRadioMetadataPool
+{
+public:
+    static const int SlotCount = 8;
+    static const unsigned SlotSize = 4096;
+
+    FMRadioMetadataPool();
+    ~FMRadioMetadataPool();
+
+    // Producer side, returns slot index or -1 if all slots are in use
+    // or heap copy of a large blob failed.
+    int acquire(const void *data, unsigned size);
+
+    // Consumer side.
+    const void *data(int slot) const;
+    unsigned size(int slot) const;
+    void release(int slot);
+
+private:
+    // unsigned int to keep same alignment as radio_metadata_t
+    unsigned int m_data[SlotCount][SlotSize / sizeof(unsigned int)];
+    unsigned m_size[SlotCount];
+    void *m_heap[SlotCount];
+    QAtomicInt m_busy[SlotCount];
+};
+
+#endif
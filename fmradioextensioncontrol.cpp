@@ -0,0 +1,237 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradioextensioncontrol.h"
+#include "fmradiordshistory.h"
+#include "fmradiostats.h"
+
+#include <QDateTime>
+
+QT_BEGIN_NAMESPACE
+
+FMRadioExtensionControl::FMRadioExtensionControl(QObject *parent, FMRadioHalControl *ctrl)
+   : QMediaControl(parent), control(ctrl)
+{
+    connect(control, SIGNAL(stationListChanged()),
+               this, SIGNAL(stationListChanged()));
+    connect(control, SIGNAL(rdsHistoryChanged()),
+               this, SIGNAL(rdsHistoryChanged()));
+    connect(control, SIGNAL(trafficAnnouncementChanged(bool)),
+               this, SIGNAL(trafficAnnouncementChanged(bool)));
+    connect(control, SIGNAL(emergencyAnnouncementChanged(bool)),
+               this, SIGNAL(emergencyAnnouncementChanged(bool)));
+    connect(control, SIGNAL(stationAdded(int, QString)),
+               this, SIGNAL(stationAdded(int, QString)));
+    connect(control, SIGNAL(stationRemoved(int)),
+               this, SIGNAL(stationRemoved(int)));
+    connect(control, SIGNAL(stationChanged(int, QString)),
+               this, SIGNAL(stationChanged(int, QString)));
+}
+
+FMRadioExtensionControl::~FMRadioExtensionControl()
+{
+    control->setRdsHistoryEnabled(this, false);
+    control->removeRdsClient(this);
+}
+
+QVariantList FMRadioExtensionControl::stationList() const
+{
+    QVector<FMRadioStationTable::Station> stations = control->stationList();
+    QVariantList list;
+    QVariantList alternatives;
+    QVariantMap entry;
+
+    for (int i = 0; i < stations.size(); ++i) {
+        const FMRadioStationTable::Station &station = stations.at(i);
+
+        if (station.alternative) {
+            alternatives.append(static_cast<int>(station.frequency) * 1000);
+            continue;
+        }
+
+        if (!entry.isEmpty()) {
+            entry.insert(QStringLiteral("alternativeFrequencies"), alternatives);
+            list.append(entry);
+            alternatives.clear();
+        }
+
+        entry.clear();
+        entry.insert(QStringLiteral("frequency"), static_cast<int>(station.frequency) * 1000);
+        entry.insert(QStringLiteral("stationId"), FMRadioStationTable::stationId(station));
+        entry.insert(QStringLiteral("signalStrength"), station.signalStrength);
+        entry.insert(QStringLiteral("stereo"), station.stereo);
+    }
+
+    if (!entry.isEmpty()) {
+        entry.insert(QStringLiteral("alternativeFrequencies"), alternatives);
+        list.append(entry);
+    }
+
+    return list;
+}
+
+QVariantList FMRadioExtensionControl::alternativeFrequencies() const
+{
+    QVector<unsigned> channels = control->alternativeFrequencies();
+    QVariantList list;
+
+    for (int i = 0; i < channels.size(); ++i)
+        list.append(static_cast<int>(channels.at(i)) * 1000);
+
+    return list;
+}
+
+bool FMRadioExtensionControl::dumpTrace(const QString &path) const
+{
+    return control->dumpTrace(path);
+}
+
+// History needs RDS delivered even without data control clients
+void FMRadioExtensionControl::setRdsHistoryEnabled(bool enabled)
+{
+    control->setRdsHistoryEnabled(this, enabled);
+
+    if (enabled)
+        control->addRdsClient(this);
+    else
+        control->removeRdsClient(this);
+}
+
+bool FMRadioExtensionControl::isRdsHistoryEnabled() const
+{
+    return control->isRdsHistoryEnabled();
+}
+
+bool FMRadioExtensionControl::isTrafficAnnouncement() const
+{
+    return control->isTrafficAnnouncement();
+}
+
+bool FMRadioExtensionControl::isEmergencyAnnouncement() const
+{
+    return control->isEmergencyAnnouncement();
+}
+
+bool FMRadioExtensionControl::isBackgroundScanSupported() const
+{
+    return control->isBackgroundScanSupported();
+}
+
+void FMRadioExtensionControl::setBackgroundScanEnabled(bool enabled)
+{
+    control->setBackgroundScanEnabled(enabled);
+}
+
+bool FMRadioExtensionControl::isBackgroundScanEnabled() const
+{
+    return control->isBackgroundScanEnabled();
+}
+
+void FMRadioExtensionControl::setStatsEnabled(bool enabled)
+{
+    control->setStatsEnabled(enabled);
+}
+
+bool FMRadioExtensionControl::isStatsEnabled() const
+{
+    return control->isStatsEnabled();
+}
+
+void FMRadioExtensionControl::resetStats()
+{
+    control->resetStats();
+}
+
+QVariantMap FMRadioExtensionControl::stats() const
+{
+    const FMRadioStats &stats = control->stats();
+    QVariantMap map;
+    QVariantMap events;
+    QVariantMap latencies;
+
+    map.insert(QStringLiteral("hal"), control->halDescription());
+    map.insert(QStringLiteral("enabled"), stats.isEnabled());
+
+    for (int i = 0; i < FMRadioStats::CounterCount; ++i) {
+        FMRadioStats::Counter counter = static_cast<FMRadioStats::Counter>(i);
+        map.insert(QLatin1String(FMRadioStats::counterName(counter)), stats.value(counter));
+    }
+
+    for (int i = 0; i < FMRadioStats::EventTypeCount; ++i)
+        events.insert(QLatin1String(FMRadioStats::eventName(i)), stats.eventValue(i));
+    map.insert(QStringLiteral("events"), events);
+
+    for (int i = 0; i < FMRadioTraceLog::SpanCount; ++i) {
+        FMRadioTraceLog::Span span = static_cast<FMRadioTraceLog::Span>(i);
+        QVariantList buckets;
+
+        for (int bucket = 0; bucket < FMRadioStats::LatencyBuckets; ++bucket)
+            buckets.append(stats.latencyValue(span, bucket));
+        latencies.insert(QLatin1String(FMRadioTraceLog::spanName(span)), buckets);
+    }
+    map.insert(QStringLiteral("latencies"), latencies);
+
+    return map;
+}
+
+QVariantMap FMRadioExtensionControl::programInfo() const
+{
+    FMRadioProgramInfo info = control->programInfo();
+    QVariantMap map;
+
+    map.insert(QStringLiteral("frequency"), info.frequency);
+    map.insert(QStringLiteral("band"), static_cast<int>(info.band));
+    map.insert(QStringLiteral("tuned"), info.tuned);
+    map.insert(QStringLiteral("stereo"), info.stereo);
+    map.insert(QStringLiteral("signalStrength"), info.signalStrength);
+    map.insert(QStringLiteral("stationId"), info.stationId);
+    map.insert(QStringLiteral("stationName"), info.stationName);
+    map.insert(QStringLiteral("radioText"), info.radioText);
+    map.insert(QStringLiteral("programType"), static_cast<int>(info.programType));
+    map.insert(QStringLiteral("programTypeName"), info.programTypeName);
+    map.insert(QStringLiteral("trafficAnnouncement"), info.trafficAnnouncement);
+    map.insert(QStringLiteral("emergencyAnnouncement"), info.emergencyAnnouncement);
+
+    return map;
+}
+
+// Strings are built only here, when the history is asked for
+QVariantList FMRadioExtensionControl::rdsHistory() const
+{
+    const FMRadioRdsHistory &history = control->rdsHistory();
+    QVariantList list;
+
+    for (int i = 0; i < history.count(); ++i) {
+        const FMRadioRdsHistory::Entry &entry = history.at(i);
+        QVariantMap map;
+
+        map.insert(QStringLiteral("time"), QDateTime::fromMSecsSinceEpoch(entry.time));
+        map.insert(QStringLiteral("frequency"), static_cast<int>(entry.frequency) * 1000);
+        map.insert(QStringLiteral("stationId"), FMRadioRdsHistory::text(entry.stationId, sizeof(entry.stationId)));
+        map.insert(QStringLiteral("stationName"), FMRadioRdsHistory::text(entry.stationName, sizeof(entry.stationName)));
+        map.insert(QStringLiteral("title"), FMRadioRdsHistory::text(entry.title, sizeof(entry.title)));
+        map.insert(QStringLiteral("artist"), FMRadioRdsHistory::text(entry.artist, sizeof(entry.artist)));
+        list.append(map);
+    }
+
+    return list;
+}
+
+QT_END_NAMESPACE
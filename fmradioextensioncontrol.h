@@ -0,0 +1,113 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOEXTENSIONCONTROL_H
+#define __FMRADIOEXTENSIONCONTROL_H
+
+#include "fmradiohalcontrol.h"
+
+#include <QMediaControl>
+#include <QVariantList>
+#include <QVariantMap>
+
+QT_BEGIN_NAMESPACE
+
+// Plugin specific additions to QRadioTuner and QRadioData, available
+// with QMediaService::requestControl(FMRadioExtensionControl_iid).
+class FMRadioExtensionControl : public QMediaControl
+{
+    Q_OBJECT
+public:
+    FMRadioExtensionControl(QObject *parent = 0, FMRadioHalControl *ctrl = 0);
+    ~FMRadioExtensionControl();
+
+    // Stations found in last search, strongest first. Every entry is a
+    // map with frequency (Hz), stationId, signalStrength, stereo and
+    // alternativeFrequencies, which lists weaker channels of the same
+    // station.
+    Q_INVOKABLE QVariantList stationList() const;
+
+    // Other frequencies (Hz) known to carry the station currently
+    // tuned, from earlier searches and AF switches.
+    Q_INVOKABLE QVariantList alternativeFrequencies() const;
+
+    // Write latencies of recent tune, seek, tuner open and RDS
+    // operations, with percentiles, to a text file.
+    Q_INVOKABLE bool dumpTrace(const QString &path) const;
+
+    // Recently received radio texts, oldest first, when enabled. Every
+    // entry is a map with time (QDateTime), frequency (Hz), stationId,
+    // stationName, title and artist. History is shared by the clients
+    // of the radio, and cleared when the last one disables it.
+    Q_INVOKABLE void setRdsHistoryEnabled(bool enabled);
+    Q_INVOKABLE bool isRdsHistoryEnabled() const;
+    Q_INVOKABLE QVariantList rdsHistory() const;
+
+    // RDS traffic (TA) and emergency (EA) announcements in progress.
+    // Changes are delivered ahead of other radio events.
+    Q_INVOKABLE bool isTrafficAnnouncement() const;
+    Q_INVOKABLE bool isEmergencyAnnouncement() const;
+
+    // Current station in one call, a map with frequency (Hz), band,
+    // tuned, stereo, signalStrength, stationId, stationName, radioText,
+    // programType, programTypeName, trafficAnnouncement and
+    // emergencyAnnouncement.
+    Q_INVOKABLE QVariantMap programInfo() const;
+
+    // Refresh of found stations while playing, with a second tuner so
+    // that audio is not interrupted. Not supported when the HAL has
+    // only one tuner. Changes from the last search are reported with
+    // frequencies in Hz, the cached station list is updated to match.
+    Q_INVOKABLE bool isBackgroundScanSupported() const;
+    Q_INVOKABLE void setBackgroundScanEnabled(bool enabled);
+    Q_INVOKABLE bool isBackgroundScanEnabled() const;
+
+    // Counters of HAL behaviour since enabled or reset, also enabled by
+    // HALRADIO_STATS=1. A map with hal (implementor, product and
+    // version), enabled, one entry per counter (tunes, seeks,
+    // seekTimeouts, stationIdTimeouts, hwFailures, commandFailures,
+    // metadataParsed, metadataRejected, metadataLarge, eventsDropped),
+    // events with a count per radio event type, and latencies with a
+    // list of log2 bucket counts per operation: entry n counts
+    // latencies of 2^(n-1) to 2^n-1 us.
+    Q_INVOKABLE void setStatsEnabled(bool enabled);
+    Q_INVOKABLE bool isStatsEnabled() const;
+    Q_INVOKABLE void resetStats();
+    Q_INVOKABLE QVariantMap stats() const;
+
+signals:
+    void stationListChanged();
+    void rdsHistoryChanged();
+    void trafficAnnouncementChanged(bool active);
+    void emergencyAnnouncementChanged(bool active);
+    void stationAdded(int frequency, QString stationId);
+    void stationRemoved(int frequency);
+    void stationChanged(int frequency, QString stationId);
+
+private:
+    FMRadioHalControl *control;
+};
+
+#define FMRadioExtensionControl_iid "org.merproject.halradio.extensioncontrol/1.0"
+Q_MEDIA_DECLARE_CONTROL(FMRadioExtensionControl, FMRadioExtensionControl_iid)
+
+QT_END_NAMESPACE
+
+#endif // __FMRADIOEXTENSIONCONTROL_H
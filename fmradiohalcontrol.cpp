@@ -19,10 +19,28 @@
 */
 
 #include "fmradiohalcontrol.h"
+#include "fmradiobackgroundscan.h"
+#include "fmradioeventqueue.h"
+#include "fmradiometadata.h"
+#include "fmradiordshistory.h"
+#include "fmradiordstext.h"
+#include "fmradiostationcache.h"
+#include "fmradiostats.h"
+#include "fmradiotrace.h"
+#include "fmradiotracelog.h"
+#include "fmradioworker.h"
 
 #include <QDebug>
-#include <QRegExp>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QDateTime>
+#include <QMetaMethod>
 #include <QLoggingCategory>
+#include <QLocale>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -44,11 +62,185 @@ extern "C" {
 
 Q_LOGGING_CATEGORY(log, "radio.fm", QtWarningMsg)
 
+// Posted with high priority for TA and EA, ahead of queued radio events
+static const QEvent::Type AnnouncementEvent = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+#define ANNOUNCEMENT_TA         0x01
+#define ANNOUNCEMENT_EA         0x02
+
 // HAL uses unsigned int kHz, Qt uses int Hz
 #define FREQ_HAL_TO_QT(f)       (static_cast<int>(f) * 1000)
 #define FREQ_QT_TO_HAL(f)       (static_cast<unsigned int>(f) / 1000)
 
-#define SEARCH_SCAN_TIMEOUT_MS  (10 * 1000)
+// Frequency changes are collected for a moment before tuning, and while
+// waiting for RADIO_EVENT_TUNED only the latest one is kept.
+#define TUNE_COALESCE_MS            (50)
+#define TUNE_TIMEOUT_MS             (3 * 1000)
+
+// Seek and PI wait timeouts are learned from earlier searches, p99 of
+// seen durations plus margin. Defaults are used until enough samples.
+// Seek timeout only grows from the default, a SearchFast sweep over
+// an empty band may take it all.
+#define SEARCH_SCAN_TIMEOUT_MS      (10 * 1000)
+#define SEARCH_SCAN_MARGIN_MS       (1000)
+#define SEARCH_PI_TIMEOUT_MS        (3 * 1000)
+#define SEARCH_PI_MIN_TIMEOUT_MS    (1000)
+#define SEARCH_PI_MARGIN_MS         (300)
+
+// Cached stations not seen for a day are verified when searching, and
+// whole band is searched again if cached list is older than a week.
+#define STATION_CACHE_STALE_SECS    (24 * 60 * 60)
+#define STATION_CACHE_VALID_SECS    (7 * 24 * 60 * 60)
+
+// Signal strength is sampled with this interval while someone is
+// listening, smoothed and only changes of at least hysteresis are
+// reported.
+#define SIGNAL_SAMPLE_INTERVAL_MS   (1000)
+#define SIGNAL_EMA_SCALE            (16)
+#define SIGNAL_EMA_WEIGHT           (4)
+#define SIGNAL_HYSTERESIS           (5)
+
+// In Auto stereo mode FM reception goes mono below the lower signal
+// strength and back to stereo above the upper one.
+#define AUTO_MONO_SIGNAL_LEVEL      (20)
+#define AUTO_STEREO_SIGNAL_LEVEL    (35)
+
+// After HW failure the tuner is reopened with doubling delay, and from
+// the third attempt on the whole HAL device is reopened.
+#define RECOVERY_INITIAL_DELAY_MS   (250)
+#define RECOVERY_MAX_DELAY_MS       (8 * 1000)
+#define RECOVERY_MAX_ATTEMPTS       (6)
+#define RECOVERY_TUNER_ATTEMPTS     (2)
+
+// Tuner without audio output or RDS clients this long is closed until
+// someone uses it again, 0 keeps it open
+#define TUNER_IDLE_TIMEOUT_MS       (60 * 1000)
+
+// Default limits and step of every band, used until the HAL is opened
+// or when HAL reports no spacings. Frequencies in Hz.
+struct BandInfo {
+    QRadioTuner::Band band;
+    radio_band_t type;
+    int lower;
+    int upper;
+    int step;
+};
+
+static const BandInfo bandTable[] = {
+    { QRadioTuner::AM, RADIO_BAND_AM,   520000,   1710000,   1000 },
+    { QRadioTuner::FM, RADIO_BAND_FM, 87500000, 108000000, 100000 },
+    { QRadioTuner::SW, RADIO_BAND_AM,  1711111,  30000000,    500 },
+    { QRadioTuner::LW, RADIO_BAND_AM,   148500,    283500,   1000 }
+};
+
+static const BandInfo *bandInfo(QRadioTuner::Band band)
+{
+    for (unsigned i = 0; i < sizeof(bandTable) / sizeof(bandTable[0]); ++i) {
+        if (bandTable[i].band == band)
+            return &bandTable[i];
+    }
+
+    return 0;
+}
+
+static bool sameBandType(radio_band_t a, radio_band_t b)
+{
+    bool fmA = a == RADIO_BAND_FM || a == RADIO_BAND_FM_HD;
+    bool fmB = b == RADIO_BAND_FM || b == RADIO_BAND_FM_HD;
+    return fmA == fmB;
+}
+
+// FM range used in a region, to choose between HAL bands with same
+// deemphasis. Frequencies in kHz.
+struct RegionInfo {
+    radio_region_t region;
+    const char *name;
+    unsigned lower;
+    unsigned upper;
+};
+
+static const RegionInfo regionTable[] = {
+    { RADIO_REGION_ITU_1, "itu1",  87500, 108000 },
+    { RADIO_REGION_ITU_2, "itu2",  87500, 108000 },
+    { RADIO_REGION_OIRT,  "oirt",  65800,  74000 },
+    { RADIO_REGION_JAPAN, "japan", 76000,  90000 },
+    { RADIO_REGION_KOREA, "korea", 88000, 108000 }
+};
+
+static const RegionInfo *regionInfo(radio_region_t region)
+{
+    for (unsigned i = 0; i < sizeof(regionTable) / sizeof(regionTable[0]); ++i) {
+        if (regionTable[i].region == region)
+            return &regionTable[i];
+    }
+
+    return &regionTable[0];
+}
+
+// Region from HALRADIO_REGION, or from the country of system locale.
+static radio_region_t resolveRegion()
+{
+    QByteArray name = qgetenv("HALRADIO_REGION").toLower();
+
+    if (!name.isEmpty()) {
+        for (unsigned i = 0; i < sizeof(regionTable) / sizeof(regionTable[0]); ++i) {
+            if (name == regionTable[i].name)
+                return regionTable[i].region;
+        }
+        qCWarning(log) << "Unknown HALRADIO_REGION" << name;
+    }
+
+    switch (QLocale::system().country()) {
+        case QLocale::Japan:
+            return RADIO_REGION_JAPAN;
+
+        case QLocale::RepublicOfKorea:
+            return RADIO_REGION_KOREA;
+
+        // 75us deemphasis and RBDS in the Americas
+        case QLocale::UnitedStates:
+        case QLocale::UnitedStatesMinorOutlyingIslands:
+        case QLocale::PuertoRico:
+        case QLocale::Canada:
+        case QLocale::Mexico:
+        case QLocale::Guatemala:
+        case QLocale::Belize:
+        case QLocale::Honduras:
+        case QLocale::ElSalvador:
+        case QLocale::Nicaragua:
+        case QLocale::CostaRica:
+        case QLocale::Panama:
+        case QLocale::Cuba:
+        case QLocale::DominicanRepublic:
+        case QLocale::Haiti:
+        case QLocale::Jamaica:
+        case QLocale::Bahamas:
+        case QLocale::TrinidadAndTobago:
+        case QLocale::Colombia:
+        case QLocale::Venezuela:
+        case QLocale::Ecuador:
+        case QLocale::Peru:
+        case QLocale::Bolivia:
+        case QLocale::Brazil:
+        case QLocale::Paraguay:
+        case QLocale::Chile:
+        case QLocale::Argentina:
+        case QLocale::Uruguay:
+            return RADIO_REGION_ITU_2;
+
+        default:
+            return RADIO_REGION_ITU_1;
+    }
+}
+
+#define CONFIG_CACHE_MAGIC      0x43464848  // "HHFC"
+#define CONFIG_CACHE_VERSION    1
+
+struct ConfigCache {
+    quint32 magic;
+    quint32 version;
+    radio_hal_band_config_t config;
+};
 
 typedef int (*libradio_metadata_check)(const radio_metadata_t*);
 typedef int (*libradio_metadata_get_count)(const radio_metadata_t*);
@@ -59,40 +251,150 @@ typedef int (*libradio_metadata_get_at_index)(const radio_metadata_t*,
                                               void**,
                                               unsigned int*);
 
+// Filled by the HAL open thread and taken over by the control thread
+// once the thread is done, so the thread never writes HalPrivate while
+// the control reads it.
+struct HalOpenState {
+    HalOpenState() : hwmod(0)
+                   , radiohw(0)
+    {
+        memset(&properties, 0, sizeof(properties));
+        memset(&config, 0, sizeof(config));
+    }
+
+    struct hw_module_t *hwmod;
+    radio_hw_device_t *radiohw;
+    radio_hal_properties_t properties;
+    radio_hal_band_config_t config;
+};
+
 struct HalPrivate {
     HalPrivate() : hwmod(0)
                  , radiohw(0)
                  , tuner(0)
+                 , libradio_metadata_tried(false)
                  , libradio_metadata_handle(0)
                  , metadata_check(0)
                  , metadata_get_count(0)
                  , metadata_get_at_index(0)
-    {}
+                 , announcementTime(0)
+                 , backgroundScan(&stations)
+    {
+        trace.setStats(&stats);
+    }
 
     struct hw_module_t *hwmod;
     radio_hw_device_t *radiohw;
     const struct radio_tuner *tuner;
     radio_hal_properties_t properties;
     radio_hal_band_config_t config;
+    // FM configuration chosen when opening, restored when switching
+    // back to FM
+    radio_hal_band_config_t fmConfig;
 
-    // metadata handling
+    // fallback metadata handling, for layouts FMRadioMetadataReader
+    // doesn't understand
+    bool libradio_metadata_tried;
     void *libradio_metadata_handle;
     libradio_metadata_check metadata_check;
     libradio_metadata_get_count metadata_get_count;
     libradio_metadata_get_at_index metadata_get_at_index;
+
+    // events and metadata copies from radio event callback thread
+    FMRadioEventQueue events;
+    FMRadioMetadataPool metadata;
+
+    // TA and EA bypass the event queue. Latest state is kept as bits,
+    // and pending is set while an AnnouncementEvent is on its way.
+    // Time is of the first event since the last AnnouncementEvent.
+    QAtomicInt announcements;
+    QAtomicInt announcementPending;
+    QAtomicInteger<qint64> announcementTime;
+
+    // sanitized RDS text, compared before building QStrings
+    FMRadioRdsText stationIdText;
+    FMRadioRdsText stationNameText;
+    FMRadioRdsText radioText;
+    FMRadioRdsText artistText;
+    FMRadioRdsHistory rdsHistory;
+
+    // stations found in previous searches
+    FMRadioStationCache stations;
+    FMRadioTimingCache timings;
+    FMRadioStationTable scanTable;
+    FMRadioBackgroundScan backgroundScan;
+
+    // HALRADIO_RECORD
+    FMRadioTraceRecorder recorder;
+
+    // operation latencies, see dumpTrace()
+    FMRadioTraceLog trace;
+
+    // HALRADIO_STATS, or enabled at runtime
+    FMRadioStats stats;
+
+    // makes the tuner calls
+    FMRadioWorker worker;
+};
+
+// Opens HAL and metadata library without blocking the control thread
+class HalOpenThread : public QThread
+{
+public:
+    HalOpenThread(FMRadioHalControl *control)
+        : QThread()
+        , m_control(control)
+    {}
+
+protected:
+    void run()
+    {
+        m_control->openRadio(state);
+    }
+
+public:
+    HalOpenState state;
+
+private:
+    FMRadioHalControl *m_control;
 };
 
 FMRadioHalControl::FMRadioHalControl()
     : QObject()
     , m_hal(new HalPrivate)
+    , m_openThread(0)
+    , m_loading(true)
     , m_error(QRadioTuner::NoError)
     , m_rdsError(QRadioData::NoError)
     , m_tunerReady(false)
     , m_antennaConnected(true)
     , m_stereoEnabled(true)
     , m_currentFreq(0)
+    , m_tuned(false)
+    , m_band(QRadioTuner::FM)
+    , m_stereoMode(QRadioTuner::Auto)
+    , m_stereoSupported(false)
+    , m_autoMono(false)
+    , m_volume(100)
+    , m_muted(false)
+    , m_tuneTimer(new QTimer(this))
+    , m_tuneInProgress(false)
+    , m_tuneQueued(false)
+    , m_tunerOpening(false)
+    , m_tunerAudio(false)
+    , m_idleTimer(new QTimer(this))
+    , m_suspended(false)
+    , m_rdsDelivered(true)
+    , m_recoveryTimer(new QTimer(this))
+    , m_recoveryAttempts(0)
+    , m_resumeSearch(false)
+    , m_resumeCandidate(-1)
+    , m_resumeVerify(false)
     , m_searchMode(QRadioTuner::SearchFast)
     , m_seekTimer(new QTimer(this))
+    , m_signalTimer(new QTimer(this))
+    , m_signalLevel(0)
+    , m_signalStrength(0)
     , m_searching(false)
     , m_searchAll(false)
     , m_searchAllLast(false)
@@ -100,52 +402,185 @@ FMRadioHalControl::FMRadioHalControl()
     , m_firstFoundFrequency(0)
     , m_searchRange(0)
     , m_lastFrequency(0)
+    , m_searchCandidate(-1)
+    , m_searchVerify(false)
+    , m_searchPiTimeout(SEARCH_PI_TIMEOUT_MS)
+    , m_backgroundScanEnabled(false)
     , m_stationId()
     , m_stationName()
     , m_programType(0)  // Undefined
     , m_radioText()
-{
+    , m_rdsStandard(0)
+    , m_rdsChanged(0)
+    , m_rdsTimer(new QTimer(this))
+    , m_rdsInterval(0)
+    , m_rdsHistoryPending(false)
+    , m_trafficAnnouncement(false)
+    , m_emergencyAnnouncement(false)
+    , m_afSupported(false)
+    , m_afEnabled(true)
+{
+    connect(&m_hal->worker, SIGNAL(commandFinished(int, int, unsigned, qint64)),
+            this, SLOT(handleCommandFinished(int, int, unsigned, qint64)));
+    connect(&m_hal->worker, SIGNAL(tunerOpened(int, void*, qint64)),
+            this, SLOT(handleTunerOpened(int, void*, qint64)));
+    connect(&m_hal->worker, SIGNAL(programInformation(int, unsigned, unsigned)),
+            this, SLOT(handleProgramInformation(int, unsigned, unsigned)));
+    m_hal->worker.start();
+
+    m_hal->stats.setEnabled(qgetenv("HALRADIO_STATS").toInt() != 0);
+
+    connect(&m_hal->backgroundScan, SIGNAL(stationAdded(unsigned, const QString&)),
+            this, SLOT(handleStationAdded(unsigned, const QString&)));
+    connect(&m_hal->backgroundScan, SIGNAL(stationRemoved(unsigned)),
+            this, SLOT(handleStationRemoved(unsigned)));
+    connect(&m_hal->backgroundScan, SIGNAL(stationChanged(unsigned, const QString&)),
+            this, SLOT(handleStationChanged(unsigned, const QString&)));
+
+    // Application forwards translator changes only to itself
+    updateProgramTypeNames();
+    if (QCoreApplication::instance())
+        QCoreApplication::instance()->installEventFilter(this);
+
+    m_tuneTimer->setSingleShot(true);
+    connect(m_tuneTimer, SIGNAL(timeout()),
+            this, SLOT(handleTuneTimeout()));
+
     m_seekTimer->setInterval(SEARCH_SCAN_TIMEOUT_MS);
     m_seekTimer->setSingleShot(false);
     connect(m_seekTimer, SIGNAL(timeout()),
             this, SLOT(handleSeekTimeout()));
 
-    // tuner calls shouldn't be made from the event callback
-    // thread, so handle SearchGetStationId seeking using signals
-    connect(this, SIGNAL(seekNextChannel()),
-            this, SLOT(searchForward()));
-
-    connect(this, SIGNAL(eventHwFailure()),
-            this, SLOT(handleHwFailure()));
-    connect(this, SIGNAL(eventConfig(int, bool)),
-            this, SLOT(handleConfig(int, bool)));
-    connect(this, SIGNAL(eventAntenna(bool)),
-            this, SLOT(handleAntenna(bool)));
-    connect(this, SIGNAL(eventTuned(unsigned, bool)),
-            this, SLOT(handleTuned(unsigned, bool)));
-    connect(this, SIGNAL(eventTA(bool)),
-            this, SLOT(handleTA(bool)));
-    connect(this, SIGNAL(eventAFSwitch(bool)),
-            this, SLOT(handleAFSwitch(bool)));
-    connect(this, SIGNAL(eventEA(bool)),
-            this, SLOT(handleEA(bool)));
-
-    openRadioMetadata();
-    openRadio();
+    bool ok;
+    int interval = qgetenv("HALRADIO_SIGNAL_INTERVAL_MS").toInt(&ok);
+    m_signalTimer->setInterval(ok && interval > 0 ? interval : SIGNAL_SAMPLE_INTERVAL_MS);
+    connect(m_signalTimer, SIGNAL(timeout()),
+            this, SLOT(handleSignalTimeout()));
+
+    m_recoveryTimer->setSingleShot(true);
+    connect(m_recoveryTimer, SIGNAL(timeout()),
+            this, SLOT(handleRecoveryTimeout()));
+
+    interval = qgetenv("HALRADIO_IDLE_TIMEOUT_MS").toInt(&ok);
+    m_idleTimer->setInterval(ok && interval >= 0 ? interval : TUNER_IDLE_TIMEOUT_MS);
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer, SIGNAL(timeout()),
+            this, SLOT(handleIdleTimeout()));
+
+    interval = qgetenv("HALRADIO_RDS_INTERVAL_MS").toInt(&ok);
+    m_rdsInterval = ok && interval > 0 ? interval : 0;
+    m_rdsTimer->setSingleShot(true);
+    connect(m_rdsTimer, SIGNAL(timeout()),
+            this, SLOT(handleRdsTimeout()));
+
+    startOpenRadio();
+}
+
+// Opening the HAL may take a while, so do it in a separate thread.
+// Until done start() and setFrequency() are only stored and applied
+// in handleHalOpened().
+void FMRadioHalControl::startOpenRadio()
+{
+    m_loading = true;
+    m_openThread = new HalOpenThread(this);
+    connect(m_openThread, SIGNAL(finished()),
+            this, SLOT(handleHalOpened()));
+    m_openThread->start();
 }
 
 FMRadioHalControl::~FMRadioHalControl()
 {
+    if (m_openThread)
+        finishOpenRadio();
+
+    QString trace = QString::fromLocal8Bit(qgetenv("HALRADIO_TRACE_FILE"));
+    if (!trace.isEmpty() && !dumpTrace(trace))
+        qCWarning(log) << "Failed to write trace to" << trace;
+
     closeRadio();
-    if (m_hal->libradio_metadata_handle)
-        android_dlclose(m_hal->libradio_metadata_handle);
+    m_hal->worker.stop();
     delete m_hal;
 }
 
-void FMRadioHalControl::openRadioMetadata()
+// Takes over what the open thread opened
+void FMRadioHalControl::finishOpenRadio()
+{
+    m_openThread->wait();
+
+    const HalOpenState &state = m_openThread->state;
+    m_hal->hwmod = state.hwmod;
+    m_hal->radiohw = state.radiohw;
+    if (state.radiohw) {
+        m_hal->properties = state.properties;
+        m_hal->config = state.config;
+    }
+
+    delete m_openThread;
+    m_openThread = 0;
+    m_loading = false;
+}
+
+void FMRadioHalControl::handleHalOpened()
 {
-    if (!m_hal || m_hal->libradio_metadata_handle)
+    finishOpenRadio();
+
+    if (!m_hal->radiohw) {
+        if (m_recoveryAttempts > 0)
+            scheduleRecovery();
         return;
+    }
+
+    qCDebug(log) << "Radio HAL ready.";
+
+    QString record = QString::fromLocal8Bit(qgetenv("HALRADIO_RECORD"));
+    if (!record.isEmpty() && !m_hal->recorder.open(record, m_hal->properties))
+        qCWarning(log) << "Failed to open radio event trace" << record;
+
+    // Seek and PI timings tell about the HAL, not the band it is on.
+    if (!m_hal->timings.open(halCacheName(m_hal->properties)))
+        qCWarning(log) << "Failed to open timing cache.";
+
+    // HAL may follow AF only if the band supports it
+    m_afSupported = m_hal->config.fm.af;
+    m_hal->config.fm.af = m_afSupported && m_afEnabled;
+    if (m_hal->config.fm.af)
+        emit alternativeFrequenciesEnabledChanged(true);
+
+    // Stereo mode may have been set before the HAL was open
+    m_stereoSupported = m_hal->config.fm.stereo;
+    m_hal->config.fm.stereo = stereoWanted();
+
+    m_hal->fmConfig = m_hal->config;
+
+    // Band may have been set before the HAL bands were known
+    if (m_band != QRadioTuner::FM && !selectBand(m_band)) {
+        qCWarning(log) << "Band" << m_band << "not supported, using FM.";
+        m_band = QRadioTuner::FM;
+        emit bandChanged(m_band);
+    }
+
+    openStationCache();
+    updateAlternativeFrequencyTable();
+
+    // Frequency may have been set before the band limits were known
+    if (m_currentFreq != 0) {
+        if (m_currentFreq < m_hal->config.lower_limit)
+            m_currentFreq = m_hal->config.lower_limit;
+        if (m_currentFreq > m_hal->config.upper_limit)
+            m_currentFreq = m_hal->config.upper_limit;
+    }
+
+    if (!m_tunerClients.isEmpty())
+        openTuner();
+}
+
+// Opened on first metadata packet the built-in reader can't handle
+bool FMRadioHalControl::openRadioMetadata()
+{
+    if (m_hal->libradio_metadata_tried)
+        return m_hal->metadata_check && m_hal->metadata_get_count && m_hal->metadata_get_at_index;
+
+    m_hal->libradio_metadata_tried = true;
 
     static const char *lib_paths[] = {
         "/vendor/lib64/libradio_metadata.so",
@@ -163,8 +598,7 @@ void FMRadioHalControl::openRadioMetadata()
 
     if (!m_hal->libradio_metadata_handle) {
         qCWarning(log) << "Failed to open metadata library.";
-        setRdsError(QRadioData::ResourceError);
-        return;
+        return false;
     }
 
     m_hal->metadata_check = reinterpret_cast<libradio_metadata_check>(android_dlsym(m_hal->libradio_metadata_handle,
@@ -177,98 +611,235 @@ void FMRadioHalControl::openRadioMetadata()
     if (m_hal->metadata_check &&
         m_hal->metadata_get_count &&
         m_hal->metadata_get_at_index) {
-        qCDebug(log) << "Radio metadata enabled.";
-    } else {
-        qCDebug(log) << "Failed to enable metadata.";
-        setRdsError(QRadioData::ResourceError);
+        qCDebug(log) << "Radio metadata library enabled.";
+        return true;
+    }
+
+    qCDebug(log) << "Failed to enable metadata library.";
+    return false;
+}
+
+// Library is probed once per HAL open, so reopening the tuner on idle
+// resume or audio change does not dlopen it again.
+void FMRadioHalControl::closeRadioMetadata()
+{
+    if (m_hal->libradio_metadata_handle) {
+        qCDebug(log) << "Close radio metadata library.";
+        android_dlclose(m_hal->libradio_metadata_handle);
+        m_hal->libradio_metadata_handle = 0;
     }
+
+    m_hal->libradio_metadata_tried = false;
+    m_hal->metadata_check = 0;
+    m_hal->metadata_get_count = 0;
+    m_hal->metadata_get_at_index = 0;
 }
 
-void FMRadioHalControl::openRadio()
+// Called in HAL open thread
+void FMRadioHalControl::openRadio(HalOpenState &state)
 {
     qCDebug(log) << "Open radio HAL.";
     hw_get_module_by_class(RADIO_HARDWARE_MODULE_ID,
                            RADIO_HARDWARE_MODULE_ID_FM,
-                           (const hw_module_t**) &m_hal->hwmod);
-    if (!m_hal->hwmod) {
+                           (const hw_module_t**) &state.hwmod);
+    if (!state.hwmod) {
         qCWarning(log) << "Failed to get " RADIO_HARDWARE_MODULE_ID "." RADIO_HARDWARE_MODULE_ID_FM;
         return;
     }
 
     int ret;
 
-    if ((ret = radio_hw_device_open(m_hal->hwmod, &m_hal->radiohw)) != 0) {
+    if ((ret = radio_hw_device_open(state.hwmod, &state.radiohw)) != 0) {
         qCWarning(log) << "Failed to open radio device:" << ret;
         return;
     }
 
-    m_hal->radiohw->get_properties(m_hal->radiohw, &m_hal->properties);
+    state.radiohw->get_properties(state.radiohw, &state.properties);
 
-    // TODO we should probably get from somewhere what region is really used.
-    // For now hard-code so we first try to set config based on region ITU-1
-    // and if not found then ITU-2.
+    // Configuration chosen for the region is cached per HAL, so that
+    // the next start can use it right away.
+    radio_region_t region = resolveRegion();
+    QString cache = configCachePath(state.properties, region);
 
-    if (!setRadioConfig(RADIO_BAND_FM, radio_demephasis_for_region(RADIO_REGION_ITU_1))) {
-        if (!setRadioConfig(RADIO_BAND_FM, radio_demephasis_for_region(RADIO_REGION_ITU_2))) {
-            qCWarning(log) << "Failed to get configuration for tuner, using default ITU-1 FM.";
-            setRadioConfigFallback();
-        }
+    qCDebug(log) << "Radio region" << regionInfo(region)->name;
+
+    if (loadRadioConfig(state, cache)) {
+        qCDebug(log) << "Using cached band configuration.";
+    } else if (setRadioConfig(state, RADIO_BAND_FM, region)
+               || setRadioConfig(state, RADIO_BAND_FM, RADIO_REGION_ITU_1)
+               || setRadioConfig(state, RADIO_BAND_FM, RADIO_REGION_ITU_2)) {
+        saveRadioConfig(state.config, cache);
+    } else {
+        qCWarning(log) << "Failed to get configuration for tuner, using default ITU-1 FM.";
+        setRadioConfigFallback(state.config);
     }
 }
 
-bool FMRadioHalControl::setRadioConfig(radio_band_t band, radio_deemphasis_t deemphasis)
+// HAL identity usable as a file name
+QString FMRadioHalControl::halCacheName(const radio_hal_properties_t &properties)
 {
-    for (unsigned i = 0; i < m_hal->properties.num_bands; ++i) {
-        if (m_hal->properties.bands[i].type == band &&
-            m_hal->properties.bands[i].fm.deemphasis == deemphasis) {
-
-            m_hal->config.type              = m_hal->properties.bands[i].type;
-            m_hal->config.antenna_connected = m_hal->properties.bands[i].antenna_connected;
-            m_hal->config.lower_limit       = m_hal->properties.bands[i].lower_limit;
-            m_hal->config.upper_limit       = m_hal->properties.bands[i].upper_limit;
-            m_hal->config.num_spacings      = m_hal->properties.bands[i].num_spacings;
-            memcpy(&m_hal->config.spacings, &m_hal->properties.bands[i].spacings, sizeof(m_hal->config.spacings));
-            m_hal->config.fm.deemphasis     = m_hal->properties.bands[i].fm.deemphasis;
-            m_hal->config.fm.stereo         = m_hal->properties.bands[i].fm.stereo;
-            m_hal->config.fm.rds            = m_hal->properties.bands[i].fm.rds;
-            m_hal->config.fm.ta             = m_hal->properties.bands[i].fm.ta;
-            m_hal->config.fm.af             = m_hal->properties.bands[i].fm.af;
-            m_hal->config.fm.ea             = false;
+    QString name = QString::fromLatin1("%1-%2-%3")
+                        .arg(QString::fromUtf8(properties.implementor))
+                        .arg(QString::fromUtf8(properties.product))
+                        .arg(QString::fromUtf8(properties.version));
+
+    for (int i = 0; i < name.size(); ++i) {
+        QChar c = name.at(i);
+        if (c.unicode() > 0x7f || !(c.isLetterOrNumber() || c == QLatin1Char('.') || c == QLatin1Char('-')))
+            name[i] = QLatin1Char('_');
+    }
+
+    return name;
+}
+
+QString FMRadioHalControl::configCachePath(const radio_hal_properties_t &properties, radio_region_t region)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+           + QStringLiteral("/qtmultimedia-halradio/config-") + halCacheName(properties)
+           + QLatin1Char('-') + QLatin1String(regionInfo(region)->name);
+}
+
+// Cached configuration is used only if HAL still has a band for it.
+bool FMRadioHalControl::loadRadioConfig(HalOpenState &state, const QString &path)
+{
+    QFile file(path);
+    ConfigCache cache;
+
+    if (!file.open(QIODevice::ReadOnly)
+        || file.read(reinterpret_cast<char*>(&cache), sizeof(cache)) != sizeof(cache)
+        || cache.magic != CONFIG_CACHE_MAGIC
+        || cache.version != CONFIG_CACHE_VERSION)
+        return false;
 
+    for (unsigned i = 0; i < state.properties.num_bands; ++i) {
+        const radio_hal_band_config_t &band = state.properties.bands[i];
+
+        if (band.type == cache.config.type
+            && (band.fm.deemphasis & cache.config.fm.deemphasis)
+            && band.lower_limit <= cache.config.lower_limit
+            && band.upper_limit >= cache.config.upper_limit) {
+            state.config = cache.config;
             return true;
         }
     }
 
+    qCDebug(log) << "Cached band configuration not valid anymore.";
     return false;
 }
 
-void FMRadioHalControl::setRadioConfigFallback()
+void FMRadioHalControl::saveRadioConfig(const radio_hal_band_config_t &config, const QString &path)
+{
+    ConfigCache cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = CONFIG_CACHE_MAGIC;
+    cache.version = CONFIG_CACHE_VERSION;
+    cache.config = config;
+
+    QFile file(path);
+
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())
+        || !file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(reinterpret_cast<const char*>(&cache), sizeof(cache)) != sizeof(cache))
+        qCWarning(log) << "Failed to cache band configuration.";
+}
+
+void FMRadioHalControl::openStationCache()
+{
+    // Found stations depend on the band configuration, so use
+    // separate cache for every configuration.
+    QString name = QString::fromLatin1("%1-%2-%3-%4")
+                        .arg(m_hal->config.type)
+                        .arg(fmBand() ? m_hal->config.fm.deemphasis : 0)
+                        .arg(m_hal->config.lower_limit)
+                        .arg(m_hal->config.upper_limit);
+
+    if (!m_hal->stations.open(name))
+        qCWarning(log) << "Failed to open station cache.";
+}
+
+// HAL reports supported deemphasis and RDS variants as bit masks, pick
+// the ones of the region from the band covering the region's range best.
+bool FMRadioHalControl::setRadioConfig(HalOpenState &state, radio_band_t band, radio_region_t region)
+{
+    const RegionInfo *info = regionInfo(region);
+    radio_deemphasis_t deemphasis = radio_demephasis_for_region(region);
+    int best = -1;
+    qint64 bestOverlap = -1;
+
+    for (unsigned i = 0; i < state.properties.num_bands; ++i) {
+        if (state.properties.bands[i].type != band ||
+            !(state.properties.bands[i].fm.deemphasis & deemphasis))
+            continue;
+
+        qint64 overlap = static_cast<qint64>(qMin(info->upper, state.properties.bands[i].upper_limit))
+                       - qMax(info->lower, state.properties.bands[i].lower_limit);
+
+        if (overlap > bestOverlap) {
+            best = i;
+            bestOverlap = overlap;
+        }
+    }
+
+    if (best < 0)
+        return false;
+
+    const radio_hal_band_config_t &properties = state.properties.bands[best];
+    radio_rds_t rds = static_cast<radio_rds_t>(properties.fm.rds & radio_rds_for_region(true, region));
+
+    state.config.type              = properties.type;
+    state.config.antenna_connected = properties.antenna_connected;
+    state.config.lower_limit       = properties.lower_limit;
+    state.config.upper_limit       = properties.upper_limit;
+    state.config.num_spacings      = properties.num_spacings;
+    memcpy(&state.config.spacings, &properties.spacings, sizeof(state.config.spacings));
+    state.config.fm.deemphasis     = deemphasis;
+    state.config.fm.stereo         = properties.fm.stereo;
+    state.config.fm.rds            = rds != RADIO_RDS_NONE ? rds : properties.fm.rds;
+    state.config.fm.ta             = properties.fm.ta;
+    state.config.fm.af             = properties.fm.af;
+    state.config.fm.ea             = false;
+
+    return true;
+}
+
+void FMRadioHalControl::setRadioConfigFallback(radio_hal_band_config_t &config)
 {
     // Fallback configs for ITU-1 FM.
-    m_hal->config.type              = RADIO_BAND_FM;
-    m_hal->config.antenna_connected = true;
-    m_hal->config.lower_limit       = 87500;
-    m_hal->config.upper_limit       = 108000;
-    m_hal->config.num_spacings      = 1;
-    m_hal->config.spacings[0]       = 100;
-    m_hal->config.fm.deemphasis     = radio_demephasis_for_region(RADIO_REGION_ITU_1);
-    m_hal->config.fm.stereo         = true;
-    m_hal->config.fm.rds            = radio_rds_for_region(true, RADIO_REGION_ITU_1);
-    m_hal->config.fm.ta             = true;
-    m_hal->config.fm.af             = false;
-    m_hal->config.fm.ea             = false;
+    config.type              = RADIO_BAND_FM;
+    config.antenna_connected = true;
+    config.lower_limit       = 87500;
+    config.upper_limit       = 108000;
+    config.num_spacings      = 1;
+    config.spacings[0]       = 100;
+    config.fm.deemphasis     = radio_demephasis_for_region(RADIO_REGION_ITU_1);
+    config.fm.stereo         = true;
+    config.fm.rds            = radio_rds_for_region(true, RADIO_REGION_ITU_1);
+    config.fm.ta             = true;
+    config.fm.af             = false;
+    config.fm.ea             = false;
 }
 
 void FMRadioHalControl::closeRadio()
 {
-    stop();
+    closeTuner();
 
     if (!m_hal || !m_hal->radiohw)
         return;
 
+    m_hal->backgroundScan.close();
+
+    // Tuner open still in progress is not reported anymore
+    m_hal->worker.flush();
+    if (const struct radio_tuner *tuner = m_hal->worker.openTuner())
+        m_hal->radiohw->close_tuner(m_hal->radiohw, tuner);
+    m_tunerOpening = false;
+
     qCDebug(log) << "Close HAL.";
     radio_hw_device_close(m_hal->radiohw);
     m_hal->radiohw = 0;
+    m_hal->recorder.close();
+    m_hal->timings.close();
+    closeRadioMetadata();
 }
 
 bool FMRadioHalControl::tunerEnabled() const
@@ -278,21 +849,70 @@ bool FMRadioHalControl::tunerEnabled() const
 
 QRadioTuner::State FMRadioHalControl::tunerState() const
 {
-    return tunerEnabled() ? QRadioTuner::ActiveState : QRadioTuner::StoppedState;
+    // Suspended tuner is still active for the clients
+    return tunerEnabled() || m_suspended ? QRadioTuner::ActiveState : QRadioTuner::StoppedState;
 }
 
 bool FMRadioHalControl::isRdsAvailable() const
 {
-    return m_hal->libradio_metadata_handle && m_hal->config.fm.rds != RADIO_RDS_NONE;
+    return !m_loading && fmBand() && m_hal->config.fm.rds != RADIO_RDS_NONE;
+}
+
+bool FMRadioHalControl::fmBand() const
+{
+    return m_hal->config.type == RADIO_BAND_FM || m_hal->config.type == RADIO_BAND_FM_HD;
 }
 
 QRadioTuner::Band FMRadioHalControl::band() const
 {
-    return QRadioTuner::FM;
+    return m_band;
 }
 
-void FMRadioHalControl::setBand(QRadioTuner::Band /* unused */)
+void FMRadioHalControl::setBand(QRadioTuner::Band b)
 {
+    if (b == m_band)
+        return;
+
+    // Applied in handleHalOpened() when still loading
+    if (m_loading) {
+        m_band = b;
+        emit bandChanged(m_band);
+        return;
+    }
+
+    cancelSearch();
+
+    if (!selectBand(b)) {
+        qCWarning(log) << "Band" << b << "not supported.";
+        return;
+    }
+
+    m_band = b;
+    qCDebug(log) << "Band changes to" << m_band << "range" << m_hal->config.lower_limit << "-" << m_hal->config.upper_limit;
+
+    // Background tuner follows on the new band
+    m_hal->backgroundScan.stop();
+
+    resetRDS();
+    openStationCache();
+    updateAlternativeFrequencyTable();
+
+    if (m_currentFreq < m_hal->config.lower_limit || m_currentFreq > m_hal->config.upper_limit)
+        m_currentFreq = m_hal->config.lower_limit;
+
+    // Same tuner is reconfigured, no need to reopen the device
+    if (m_hal->tuner) {
+        setConfiguration();
+        if (tunerEnabled())
+            setTuning();
+    }
+
+    // Automatic mono is only used on FM
+    updateSignalSampling();
+    updateBackgroundScan();
+
+    emit bandChanged(m_band);
+    emit frequencyChanged(FREQ_HAL_TO_QT(m_currentFreq));
 }
 
 bool FMRadioHalControl::isBandSupported(QRadioTuner::Band b) const
@@ -300,7 +920,96 @@ bool FMRadioHalControl::isBandSupported(QRadioTuner::Band b) const
     if (b == QRadioTuner::FM)
         return true;
 
-    return false;
+    return halBandIndex(b) >= 0;
+}
+
+// HAL band descriptor of given type overlapping the default range of
+// the band most, or -1 if there is none.
+int FMRadioHalControl::halBandIndex(QRadioTuner::Band b) const
+{
+    const BandInfo *info = bandInfo(b);
+
+    if (!info || m_loading || !m_hal->radiohw)
+        return -1;
+
+    int best = -1;
+    qint64 bestOverlap = 0;
+
+    for (unsigned i = 0; i < m_hal->properties.num_bands; ++i) {
+        const radio_hal_band_config_t &band = m_hal->properties.bands[i];
+
+        if (!sameBandType(band.type, info->type))
+            continue;
+
+        qint64 overlap = qMin<qint64>(info->upper, FREQ_HAL_TO_QT(band.upper_limit))
+                       - qMax<qint64>(info->lower, FREQ_HAL_TO_QT(band.lower_limit));
+
+        if (overlap > bestOverlap) {
+            best = i;
+            bestOverlap = overlap;
+        }
+    }
+
+    return best;
+}
+
+// Only changes the configuration, returns false if band not supported.
+bool FMRadioHalControl::selectBand(QRadioTuner::Band b)
+{
+    if (b == QRadioTuner::FM) {
+        m_hal->config = m_hal->fmConfig;
+        return true;
+    }
+
+    int index = halBandIndex(b);
+    if (index < 0)
+        return false;
+
+    m_hal->config = m_hal->properties.bands[index];
+
+    return true;
+}
+
+// Band configuration for b, current one when b is the current band
+const radio_hal_band_config_t *FMRadioHalControl::bandConfig(QRadioTuner::Band b) const
+{
+    if (m_loading || !m_hal->radiohw)
+        return 0;
+
+    if (b == m_band)
+        return &m_hal->config;
+
+    if (b == QRadioTuner::FM)
+        return &m_hal->fmConfig;
+
+    int index = halBandIndex(b);
+    return index >= 0 ? &m_hal->properties.bands[index] : 0;
+}
+
+int FMRadioHalControl::frequencyStep(QRadioTuner::Band b) const
+{
+    const radio_hal_band_config_t *config = bandConfig(b);
+
+    if (config && config->num_spacings > 0) {
+        unsigned spacing = config->spacings[0];
+        for (unsigned i = 1; i < config->num_spacings && i < RADIO_NUM_SPACINGS_MAX; ++i)
+            spacing = qMin(spacing, config->spacings[i]);
+        return FREQ_HAL_TO_QT(spacing);
+    }
+
+    const BandInfo *info = bandInfo(b);
+    return info ? info->step : 0;
+}
+
+QPair<int,int> FMRadioHalControl::frequencyRange(QRadioTuner::Band b) const
+{
+    const radio_hal_band_config_t *config = bandConfig(b);
+
+    if (config)
+        return qMakePair<int,int>(FREQ_HAL_TO_QT(config->lower_limit), FREQ_HAL_TO_QT(config->upper_limit));
+
+    const BandInfo *info = bandInfo(b);
+    return info ? qMakePair<int,int>(info->lower, info->upper) : qMakePair<int,int>(0, 0);
 }
 
 int FMRadioHalControl::frequency() const
@@ -315,20 +1024,51 @@ void FMRadioHalControl::setFrequency(int newFrequency)
     if (frequency == m_currentFreq)
         return;
 
+    if (m_loading) {
+        m_currentFreq = frequency;
+        return;
+    }
+
     if (frequency < m_hal->config.lower_limit)
         frequency = m_hal->config.lower_limit;
     if (frequency > m_hal->config.upper_limit)
         frequency = m_hal->config.upper_limit;
 
+    if (frequency == m_currentFreq)
+        return;
+
     m_currentFreq = frequency;
 
     qCDebug(log) << "Set frequency" << m_currentFreq;
 
+    // Reported right away, TUNED confirms it later
+    emit frequencyChanged(FREQ_HAL_TO_QT(m_currentFreq));
+
     if (!tunerEnabled())
         return;
 
     resetRDS();
-    setTuning();
+    scheduleTuning();
+}
+
+void FMRadioHalControl::scheduleTuning()
+{
+    m_tuneQueued = true;
+
+    if (!m_tuneInProgress && !m_tuneTimer->isActive())
+        m_tuneTimer->start(TUNE_COALESCE_MS);
+}
+
+// Coalescing window passed, or TUNED never came for previous tune
+void FMRadioHalControl::handleTuneTimeout()
+{
+    if (m_tuneInProgress) {
+        qCWarning(log) << "No tune result in" << TUNE_TIMEOUT_MS << "ms.";
+        m_tuneInProgress = false;
+    }
+
+    if (m_tuneQueued && tunerEnabled())
+        setTuning();
 }
 
 bool FMRadioHalControl::isStereo() const
@@ -338,87 +1078,468 @@ bool FMRadioHalControl::isStereo() const
 
 QRadioTuner::StereoMode FMRadioHalControl::stereoMode() const
 {
-    return QRadioTuner::Auto;
+    return m_stereoMode;
 }
 
-void FMRadioHalControl::setStereoMode(QRadioTuner::StereoMode /* unused */)
+void FMRadioHalControl::setStereoMode(QRadioTuner::StereoMode mode)
 {
+    if (mode == m_stereoMode)
+        return;
+
+    qCDebug(log) << "Stereo mode changes to" << mode;
+    m_stereoMode = mode;
+    m_autoMono = false;
+
+    updateAutoMono();
+    applyStereoMode();
+    updateSignalSampling();
 }
 
-int FMRadioHalControl::signalStrength() const
+// FM stereo reception wanted with current mode and signal strength
+bool FMRadioHalControl::stereoWanted() const
+{
+    if (!m_stereoSupported || m_stereoMode == QRadioTuner::ForceMono)
+        return false;
+
+    if (m_stereoMode == QRadioTuner::ForceStereo)
+        return true;
+
+    return !m_autoMono;
+}
+
+bool FMRadioHalControl::autoMonoEnabled() const
 {
-    return 100;
+    return m_stereoMode == QRadioTuner::Auto && m_stereoSupported && fmBand();
 }
 
-int FMRadioHalControl::volume() const
+// Same tuner is reconfigured, no need to reopen the device
+void FMRadioHalControl::applyStereoMode()
 {
-    return 100;
+    if (m_loading || !m_hal->radiohw || !fmBand())
+        return;
+
+    bool stereo = stereoWanted();
+
+    if (m_hal->config.fm.stereo == stereo)
+        return;
+
+    qCDebug(log) << "Set FM reception to" << (stereo ? "stereo" : "mono");
+    m_hal->config.fm.stereo = stereo;
+    m_hal->fmConfig.fm.stereo = stereo;
+
+    if (m_hal->tuner)
+        setConfiguration();
 }
 
-void FMRadioHalControl::setVolume(int /* unused */)
+// Hysteresis keeps weak stations from flapping between modes
+void FMRadioHalControl::updateAutoMono()
 {
+    if (!autoMonoEnabled() || !tunerEnabled() || m_searching)
+        return;
+
+    bool mono = m_signalStrength < (m_autoMono ? AUTO_STEREO_SIGNAL_LEVEL : AUTO_MONO_SIGNAL_LEVEL);
+
+    if (mono != m_autoMono) {
+        qCDebug(log) << "Signal strength" << m_signalStrength << (mono ? "too weak for" : "good for") << "stereo";
+        m_autoMono = mono;
+        applyStereoMode();
+    }
 }
 
-bool FMRadioHalControl::isMuted() const
+int FMRadioHalControl::signalStrength() const
 {
-    return false;
+    return m_signalStrength;
 }
 
-void FMRadioHalControl::setMuted(bool /* unused */)
+void FMRadioHalControl::connectNotify(const QMetaMethod &signal)
 {
+    if (signal == QMetaMethod::fromSignal(&FMRadioHalControl::signalStrengthChanged))
+        updateSignalSampling();
 }
 
-bool FMRadioHalControl::isSearching() const
+void FMRadioHalControl::disconnectNotify(const QMetaMethod &signal)
 {
-    return m_searching;
+    if (signal == QMetaMethod::fromSignal(&FMRadioHalControl::signalStrengthChanged))
+        updateSignalSampling();
 }
 
-bool FMRadioHalControl::isAntennaConnected() const
+// Sample signal strength only when tuner is active and someone cares
+void FMRadioHalControl::updateSignalSampling()
 {
-    return m_antennaConnected;
+    bool sample = tunerEnabled()
+                  && (autoMonoEnabled()
+                      || isSignalConnected(QMetaMethod::fromSignal(&FMRadioHalControl::signalStrengthChanged)));
+
+    if (sample && !m_signalTimer->isActive())
+        m_signalTimer->start();
+    else if (!sample && m_signalTimer->isActive())
+        m_signalTimer->stop();
 }
 
-void FMRadioHalControl::seek(radio_direction_t direction)
+void FMRadioHalControl::handleSignalTimeout()
 {
     if (!tunerEnabled())
         return;
 
-    if (!m_searchAll)
-        resetRDS();
-
-    m_seekTimer->start();
-
-    int ret = m_hal->tuner->scan(m_hal->tuner, direction, false);
-
-    if (ret == 0) {
-        if (!m_searchAll)
-            setSearching(true);
-    } else
-        qCWarning(log) << "Failed to scan" << (direction == RADIO_DIRECTION_UP ? "forward:" : "backward:") << ret;
+    m_hal->worker.post(FMRadioWorker::command(FMRadioCommand::GetProgramInformation, m_hal->tuner));
 }
 
-void FMRadioHalControl::resetRDS()
+void FMRadioHalControl::handleProgramInformation(int result, unsigned channel, unsigned signalStrength)
 {
+    if (result != 0) {
+        qCDebug(log) << "Failed to get program information:" << result;
+        return;
+    }
+
+    // Sampled before tuning elsewhere
+    if (!tunerEnabled() || channel != m_currentFreq)
+        return;
+
+    updateSignalStrength(signalStrength, false);
+}
+
+void FMRadioHalControl::updateSignalStrength(unsigned strength, bool reset)
+{
+    int level = static_cast<int>(qMin(strength, 100u)) * SIGNAL_EMA_SCALE;
+
+    if (reset)
+        m_signalLevel = level;
+    else
+        m_signalLevel += (level - m_signalLevel) / SIGNAL_EMA_WEIGHT;
+
+    int value = (m_signalLevel + SIGNAL_EMA_SCALE / 2) / SIGNAL_EMA_SCALE;
+
+    if (value == m_signalStrength)
+        return;
+
+    if (reset || value == 0 || value == 100 || qAbs(value - m_signalStrength) >= SIGNAL_HYSTERESIS) {
+        m_signalStrength = value;
+        emit signalStrengthChanged(m_signalStrength);
+        updateAutoMono();
+    }
+}
+
+// Legacy radio HAL has no volume or mute controls, only the audio flag
+// of open_tuner() which routes tuner output to audio. Muting, or volume
+// 0, reopens the tuner without audio. Other volumes are kept as state
+// that audio side can follow through the signals.
+int FMRadioHalControl::volume() const
+{
+    return m_volume;
+}
+
+void FMRadioHalControl::setVolume(int volume)
+{
+    volume = qBound(0, volume, 100);
+
+    if (volume != m_volume) {
+        m_volume = volume;
+        qCDebug(log) << "Volume changes to" << m_volume;
+        emit volumeChanged(m_volume);
+    }
+
+    if (audioWanted() && m_suspended)
+        resumeTuner();
+
+    updateAudio();
+    updateIdle();
+}
+
+bool FMRadioHalControl::isMuted() const
+{
+    return m_muted;
+}
+
+void FMRadioHalControl::setMuted(bool muted)
+{
+    if (muted != m_muted) {
+        m_muted = muted;
+        qCDebug(log) << "Mute changes to" << (m_muted ? "true" : "false");
+        emit mutedChanged(m_muted);
+    }
+
+    if (audioWanted() && m_suspended)
+        resumeTuner();
+
+    updateAudio();
+    updateIdle();
+}
+
+bool FMRadioHalControl::audioWanted() const
+{
+    return !m_muted && m_volume > 0;
+}
+
+// Switching audio output needs the tuner reopened, which is done as
+// when suspended, clients see the tuner active meanwhile. Searches and
+// recovery finish first.
+void FMRadioHalControl::updateAudio()
+{
+    if (!m_hal || !m_hal->tuner || m_tunerOpening || !m_tunerReady
+        || m_searching || m_recoveryAttempts > 0 || m_tunerAudio == audioWanted())
+        return;
+
+    qCDebug(log) << "Reopen tuner with audio" << (audioWanted() ? "on." : "off.");
+    m_suspended = true;
+    closeTuner();
+    openTuner();
+}
+
+// Nobody listens to a tuner without audio output when there are no RDS
+// clients either, so it is closed after a while.
+bool FMRadioHalControl::tunerIdle() const
+{
+    return tunerEnabled()
+           && !m_tunerAudio
+           && m_rdsClients.isEmpty()
+           && !m_searching
+           && !m_backgroundScanEnabled
+           && m_recoveryAttempts == 0;
+}
+
+void FMRadioHalControl::updateIdle()
+{
+    bool idle = tunerIdle() && m_idleTimer->interval() > 0;
+
+    if (idle && !m_idleTimer->isActive())
+        m_idleTimer->start();
+    else if (!idle && m_idleTimer->isActive())
+        m_idleTimer->stop();
+}
+
+void FMRadioHalControl::handleIdleTimeout()
+{
+    if (!tunerIdle())
+        return;
+
+    qCDebug(log) << "Tuner idle, suspend until used again.";
+    m_suspended = true;
+    closeTuner();
+}
+
+// Band configuration and frequency are kept, so reopening skips the
+// configuration selection done when the HAL was opened. Recovery
+// reopens the tuner by itself.
+void FMRadioHalControl::resumeTuner()
+{
+    if (m_recoveryAttempts > 0 || m_hal->tuner || m_tunerOpening)
+        return;
+
+    qCDebug(log) << "Resume suspended tuner.";
+    openTuner();
+}
+
+bool FMRadioHalControl::isBackgroundScanSupported() const
+{
+    return !m_loading && m_hal->radiohw && FMRadioBackgroundScan::isSupported(m_hal->properties);
+}
+
+void FMRadioHalControl::setBackgroundScanEnabled(bool enabled)
+{
+    if (enabled == m_backgroundScanEnabled)
+        return;
+
+    m_backgroundScanEnabled = enabled;
+    qCDebug(log) << "Background scan" << (enabled ? "enabled" : "disabled");
+    updateBackgroundScan();
+
+    if (enabled && m_suspended)
+        resumeTuner();
+    updateIdle();
+}
+
+bool FMRadioHalControl::isBackgroundScanEnabled() const
+{
+    return m_backgroundScanEnabled;
+}
+
+// Runs only while playing; searches and recovery have the HAL to
+// themselves.
+void FMRadioHalControl::updateBackgroundScan()
+{
+    bool wanted = m_backgroundScanEnabled
+                  && isBackgroundScanSupported()
+                  && fmBand()
+                  && tunerEnabled()
+                  && !m_searching
+                  && m_recoveryAttempts == 0;
+
+    if (wanted)
+        m_hal->backgroundScan.start(m_hal->radiohw, m_hal->config, stationIdTimeout());
+    else
+        m_hal->backgroundScan.stop();
+}
+
+void FMRadioHalControl::handleStationAdded(unsigned channel, const QString &stationId)
+{
+    emit stationAdded(FREQ_HAL_TO_QT(channel), stationId);
+}
+
+void FMRadioHalControl::handleStationRemoved(unsigned channel)
+{
+    emit stationRemoved(FREQ_HAL_TO_QT(channel));
+}
+
+void FMRadioHalControl::handleStationChanged(unsigned channel, const QString &stationId)
+{
+    emit stationChanged(FREQ_HAL_TO_QT(channel), stationId);
+}
+
+void FMRadioHalControl::addRdsClient(QObject *client)
+{
+    m_rdsClients.insert(client);
+    updateRdsDelivery();
+
+    if (m_suspended)
+        resumeTuner();
+    updateIdle();
+}
+
+void FMRadioHalControl::removeRdsClient(QObject *client)
+{
+    m_rdsClients.remove(client);
+    updateRdsDelivery();
+    updateIdle();
+}
+
+// Metadata is delivered by the HAL only when someone uses it, or when
+// station ids are needed for a search.
+bool FMRadioHalControl::rdsWanted() const
+{
+    return !m_rdsClients.isEmpty()
+           || (m_searchAll && m_searchMode == QRadioTuner::SearchGetStationId);
+}
+
+radio_hal_band_config_t FMRadioHalControl::tunerConfig() const
+{
+    radio_hal_band_config_t config = m_hal->config;
+
+    if (fmBand() && !m_rdsDelivered)
+        config.fm.rds = RADIO_RDS_NONE;
+
+    return config;
+}
+
+void FMRadioHalControl::updateRdsDelivery()
+{
+    bool deliver = rdsWanted();
+
+    if (deliver == m_rdsDelivered)
+        return;
+
+    m_rdsDelivered = deliver;
+
+    if (m_loading || !m_hal->radiohw || !fmBand() || m_hal->config.fm.rds == RADIO_RDS_NONE)
+        return;
+
+    qCDebug(log) << "RDS delivery" << (deliver ? "enabled." : "disabled.");
+    if (m_hal->tuner)
+        setConfiguration();
+}
+
+bool FMRadioHalControl::isSearching() const
+{
+    return m_searching;
+}
+
+bool FMRadioHalControl::isAntennaConnected() const
+{
+    return m_antennaConnected;
+}
+
+void FMRadioHalControl::seek(radio_direction_t direction)
+{
+    if (!tunerEnabled())
+        return;
+
+    if (!m_searchAll)
+        resetRDS();
+
+    // Seek supersedes any pending tune
+    m_tuneTimer->stop();
+    m_tuneInProgress = false;
+    m_tuneQueued = false;
+
+    m_seekTimer->start(seekTimeout());
+
+    // Assume scan starts, failure is handled in handleCommandFinished()
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::Scan, m_hal->tuner);
+    command.time = FMRadioTraceLog::now();
+    command.direction = direction;
+    m_hal->worker.post(command);
+    m_hal->trace.start(FMRadioTraceLog::Seek, command.time, 0);
+    m_hal->stats.count(FMRadioStats::Seeks);
+
+    m_seekClock.start();
+    if (!m_searchAll)
+        setSearching(true);
+}
+
+void FMRadioHalControl::resetRDS()
+{
+    m_hal->stationIdText.clear();
+    m_hal->stationNameText.clear();
+    m_hal->radioText.clear();
+    m_hal->artistText.clear();
+    m_rdsHistoryPending = false;
+
     if (!m_radioText.isEmpty()) {
         m_radioText.clear();
-        emit radioTextChanged(m_radioText);
+        m_rdsChanged |= FMRadioRdsData::RadioText;
     }
 
     if (!m_stationName.isEmpty()) {
         m_stationName.clear();
-        emit stationNameChanged(m_stationName);
+        m_rdsChanged |= FMRadioRdsData::StationName;
     }
 
     if (m_programType != 0) {
         m_programType = 0; // Undefined
-        emit programTypeChanged(programTypeValue(0, m_programType));
-        emit programTypeNameChanged(programTypeNameString(0, 0));
+        m_rdsStandard = 0;
+        m_rdsChanged |= FMRadioRdsData::ProgramType;
     }
 
     if (!m_stationId.isEmpty()) {
         m_stationId.clear();
-        emit stationIdChanged(m_stationId);
+        m_rdsChanged |= FMRadioRdsData::StationId;
+    }
+
+    publishRds();
+}
+
+// Deliver all RDS changes since the previous call at once, at most
+// once per HALRADIO_RDS_INTERVAL_MS if set.
+void FMRadioHalControl::publishRds()
+{
+    if (m_rdsChanged == 0 || m_rdsTimer->isActive())
+        return;
+
+    if (m_rdsInterval > 0 && m_rdsClock.isValid()) {
+        qint64 remaining = m_rdsInterval - m_rdsClock.elapsed();
+        if (remaining > 0) {
+            m_rdsTimer->start(static_cast<int>(remaining));
+            return;
+        }
     }
+
+    FMRadioRdsData rds;
+    rds.changed = m_rdsChanged;
+    rds.stationId = m_stationId;
+    rds.stationName = m_stationName;
+    rds.radioText = m_radioText;
+    rds.programType = programTypeValue(m_rdsStandard, m_programType);
+    rds.programTypeName = programTypeNameString(m_rdsStandard, m_programType);
+
+    m_rdsChanged = 0;
+    m_rdsClock.start();
+
+    m_hal->trace.finish(FMRadioTraceLog::Metadata, m_currentFreq, FMRadioTraceLog::now());
+    emit rdsUpdated(rds);
+}
+
+void FMRadioHalControl::handleRdsTimeout()
+{
+    publishRds();
 }
 
 void FMRadioHalControl::setSearching(bool searching)
@@ -430,6 +1551,15 @@ void FMRadioHalControl::setSearching(bool searching)
         m_searching = searching;
         emit searchingChanged(m_searching);
     }
+
+    updateRdsDelivery();
+    updateIdle();
+    updateBackgroundScan();
+
+    // Muted or unmuted while searching, not reopened in the middle of
+    // handling the last tuned event
+    if (!m_searching && m_tunerAudio != audioWanted())
+        QMetaObject::invokeMethod(this, "updateAudio", Qt::QueuedConnection);
 }
 
 void FMRadioHalControl::setStereoEnabled(bool enabled)
@@ -453,19 +1583,26 @@ void FMRadioHalControl::searchBackward()
 
 void FMRadioHalControl::handleSeekTimeout()
 {
+    // Same timer waits for scan() and for SearchGetStationId candidates
+    m_hal->stats.count(m_searchAll && m_searchCandidate >= 0 ? FMRadioStats::StationIdTimeouts
+                                                             : FMRadioStats::SeekTimeouts);
+    seekDone(true);
+
+    // Tuner closed meanwhile, search was cancelled with it
+    if (!m_hal->tuner)
+        return;
+
     if (m_searchAll) {
-        if (m_searchMode == QRadioTuner::SearchFast) {
-            qCDebug(log) << "SearchFast timeout. Cancel search.";
-            cancelSearch();
+        if (m_searchCandidate >= 0) {
+            qCDebug(log) << "SearchGetStationId channel" << m_currentFreq << "timeout while waiting RDS.";
+            searchCandidateDone(false);
+        } else if (m_searchMode == QRadioTuner::SearchGetStationId && !m_searchCandidates.isEmpty()) {
+            qCDebug(log) << "SearchGetStationId scan timeout, continue with found channels.";
+            m_hal->worker.post(FMRadioWorker::command(FMRadioCommand::Cancel, m_hal->tuner));
+            startSearchCandidates();
         } else {
-            if (m_firstFoundFrequency == 0) {
-                qCDebug(log) << "SearchGetStationId timeout. Cancel search.";
-                cancelSearch();
-            } else {
-                qCDebug(log) << "SearchGetStationId found channel" << m_currentFreq << ": \"\" (timeout while waiting RDS).";
-                emit stationFound(FREQ_HAL_TO_QT(m_currentFreq), m_stationId);
-                searchForward();
-            }
+            qCDebug(log) << "Search all timeout. Cancel search.";
+            cancelSearch();
         }
     } else
         cancelSearch();
@@ -492,55 +1629,213 @@ void FMRadioHalControl::searchAllStations(QRadioTuner::SearchMode searchMode)
     // first tuned frequency and emit that only if it differs from
     // last found frequency.
     //
-    // QRadioTuner::SearchGetStationId differs from this sequence
-    // in that after every scan (3) we will wait until RDS_PI RDS
-    // event is received or seek timer fires, then scan forward.
-    // Search is cancelled only if no channel has been found during
-    // the initial scanning.
+    // QRadioTuner::SearchGetStationId is done in two phases. First
+    // the band is scanned as with SearchFast, but found channels are
+    // only collected as candidates. Then every candidate is tuned in
+    // turn and we wait until RDS_PI RDS event is received or the PI
+    // timeout fires, and emit the channel with its station id. The
+    // PI timeout adapts to the slowest PI seen during the search, so
+    // channels without RDS cost only little more than in SearchFast.
+
+    if (!tunerEnabled())
+        return;
 
     resetRDS();
 
-    if (m_hal->config.fm.rds == RADIO_RDS_NONE)
+    if (!fmBand() || m_hal->config.fm.rds == RADIO_RDS_NONE)
         m_searchMode = QRadioTuner::SearchFast;
     else
         m_searchMode = searchMode;
 
-    if (m_searchMode == QRadioTuner::SearchGetStationId)
-        m_searchWaitForRDS = true;
-
     m_searchAll = true;
     m_searchAllLast = false;
+    m_searchWaitForRDS = false;
     m_firstFoundFrequency = 0;
+    m_searchCandidates.clear();
+    m_searchCandidate = -1;
+    m_searchVerify = false;
+    m_searchPiTimeout = stationIdTimeout();
+
+    m_hal->scanTable.clear();
+    setSearching(true);
+
+    if (stationCacheValid()) {
+        searchFromCache();
+        return;
+    }
+
+    m_hal->stations.clear();
+
     m_searchRange = m_hal->config.upper_limit - m_hal->config.lower_limit;
     m_lastFrequency = m_currentFreq - m_hal->config.lower_limit;
 
     qCDebug(log) << "Search all stations, start from" << m_currentFreq << "range" << m_searchRange;
-    setSearching(true);
     searchForward();
 }
 
+bool FMRadioHalControl::stationCacheValid() const
+{
+    if (m_hal->stations.count() == 0 || m_hal->stations.lastScan() == 0)
+        return false;
+
+    // Stations cached by SearchFast don't have station ids
+    if (m_searchMode == QRadioTuner::SearchGetStationId
+        && m_hal->stations.scanMode() != QRadioTuner::SearchGetStationId)
+        return false;
+
+    return QDateTime::currentMSecsSinceEpoch() / 1000 - m_hal->stations.lastScan() < STATION_CACHE_VALID_SECS;
+}
+
+void FMRadioHalControl::searchFromCache()
+{
+    // Report all cached stations right away, then verify the ones
+    // which haven't been seen for a while.
+
+    qint64 stale = QDateTime::currentMSecsSinceEpoch() / 1000 - STATION_CACHE_STALE_SECS;
+    FMRadioStationCache::Locker locker(&m_hal->stations);
+
+    for (int i = 0; i < m_hal->stations.count(); ++i) {
+        const FMRadioStation &station = m_hal->stations.at(i);
+        emit stationFound(FREQ_HAL_TO_QT(station.frequency), FMRadioStationCache::stationId(station));
+        m_hal->scanTable.update(station.frequency, station.signalStrength, station.stereo);
+        m_hal->scanTable.setStationId(station.frequency, FMRadioStationCache::stationId(station));
+
+        if (station.lastSeen < stale)
+            m_searchCandidates.append(station.frequency);
+    }
+
+    qCDebug(log) << "Search all stations from cache," << m_hal->stations.count() << "stations,"
+                 << m_searchCandidates.size() << "to verify.";
+
+    m_searchVerify = true;
+    startSearchCandidates();
+}
+
 void FMRadioHalControl::cancelSearch()
 {
     if (!m_searching || !tunerEnabled())
         return;
 
-    int ret = m_hal->tuner->cancel(m_hal->tuner);
+    m_hal->worker.post(FMRadioWorker::command(FMRadioCommand::Cancel, m_hal->tuner));
 
     qCDebug(log) << "Cancel" << (m_searchAll ? "searchAll" : "search");
+    m_seekClock.invalidate();
     m_searchAll = false;
     m_searchAllLast = false;
     m_searchWaitForRDS = false;
+    m_searchCandidates.clear();
+    m_searchCandidate = -1;
+    m_searchVerify = false;
     setSearching(false);
-
-    if (ret != 0)
-        qCWarning(log) << "Failed to cancel:" << ret;
 }
 
 void FMRadioHalControl::handleHwFailure()
 {
-    qCWarning(log) << "Tuner HW Failure, reset tuner to stopped state.";
-    setError(QRadioTuner::ResourceError);
-    stop();
+    m_hal->stats.count(FMRadioStats::HwFailures);
+
+    if (m_tunerClients.isEmpty()) {
+        qCWarning(log) << "Tuner HW Failure, reset tuner to stopped state.";
+        setError(QRadioTuner::ResourceError);
+        closeTuner();
+        return;
+    }
+
+    // Failed again while recovering, next attempt
+    if (m_recoveryAttempts > 0) {
+        qCWarning(log) << "Tuner HW Failure during recovery.";
+        closeTuner();
+        scheduleRecovery();
+        return;
+    }
+
+    qCWarning(log) << "Tuner HW Failure, try to recover.";
+    m_hal->trace.start(FMRadioTraceLog::Recovery, FMRadioTraceLog::now(), 0);
+
+    // Search continues from where it was after recovery
+    if (m_searchAll) {
+        m_resumeSearch = true;
+        m_resumeCandidates = m_searchCandidates;
+        m_resumeCandidate = m_searchCandidate;
+        m_resumeVerify = m_searchVerify;
+    }
+
+    // Clients see the tuner active while it is reopened
+    m_suspended = true;
+    closeTuner();
+    scheduleRecovery();
+}
+
+void FMRadioHalControl::scheduleRecovery()
+{
+    if (m_recoveryAttempts >= RECOVERY_MAX_ATTEMPTS) {
+        qCWarning(log) << "Tuner recovery failed after" << m_recoveryAttempts << "attempts.";
+        m_hal->trace.cancel(FMRadioTraceLog::Recovery);
+        stopRecovery();
+        setError(QRadioTuner::ResourceError);
+        if (m_suspended) {
+            m_suspended = false;
+            emit stateChanged(QRadioTuner::StoppedState);
+        }
+        return;
+    }
+
+    int delay = qMin(RECOVERY_INITIAL_DELAY_MS << m_recoveryAttempts, RECOVERY_MAX_DELAY_MS);
+    m_recoveryAttempts++;
+
+    qCDebug(log) << "Tuner recovery attempt" << m_recoveryAttempts << "in" << delay << "ms";
+    m_recoveryTimer->start(delay);
+}
+
+void FMRadioHalControl::handleRecoveryTimeout()
+{
+    if (m_tunerClients.isEmpty() || m_loading)
+        return;
+
+    // Tuner alone may not come back if firmware was reset
+    if (m_recoveryAttempts <= RECOVERY_TUNER_ATTEMPTS) {
+        openTuner();
+        return;
+    }
+
+    qCDebug(log) << "Reopen radio HAL.";
+    closeRadio();
+    startOpenRadio();
+}
+
+void FMRadioHalControl::stopRecovery()
+{
+    m_recoveryTimer->stop();
+    m_recoveryAttempts = 0;
+    m_resumeSearch = false;
+    m_resumeCandidates.clear();
+    m_resumeCandidate = -1;
+    m_resumeVerify = false;
+
+    updateBackgroundScan();
+}
+
+// Called when tuned to the frequency of the interrupted search
+void FMRadioHalControl::resumeSearch()
+{
+    qCDebug(log) << "Resume search after recovery.";
+
+    m_searchAll = true;
+    m_searchAllLast = false;
+    m_searchWaitForRDS = false;
+    m_searchCandidates = m_resumeCandidates;
+    m_searchVerify = m_resumeVerify;
+    m_searchPiTimeout = stationIdTimeout();
+    setSearching(true);
+
+    if (m_resumeCandidate >= 0) {
+        m_searchCandidate = m_resumeCandidate - 1;
+        stopRecovery();
+        nextSearchCandidate();
+    } else {
+        m_searchCandidate = -1;
+        stopRecovery();
+        searchForward();
+    }
 }
 
 void FMRadioHalControl::setTuning()
@@ -550,9 +1845,85 @@ void FMRadioHalControl::setTuning()
 
     qCDebug(log) << "Apply frequency" << m_currentFreq;
 
-    int ret = m_hal->tuner->tune(m_hal->tuner, m_currentFreq, 0);
-    if (ret != 0)
-        qCWarning(log) << "Radio tune failed:" << ret;
+    m_tuneQueued = false;
+
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::Tune, m_hal->tuner);
+    command.time = FMRadioTraceLog::now();
+    command.channel = m_currentFreq;
+    m_hal->worker.post(command);
+    m_hal->trace.start(FMRadioTraceLog::Tune, command.time, 0);
+    m_hal->stats.count(FMRadioStats::Tunes);
+
+    m_tuneInProgress = true;
+    m_tuneTimer->start(TUNE_TIMEOUT_MS);
+}
+
+void FMRadioHalControl::setConfiguration()
+{
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::SetConfiguration, m_hal->tuner);
+    command.config = tunerConfig();
+    m_hal->worker.post(command);
+}
+
+// Failed commands are undone here, commands are assumed to succeed
+// when posted.
+void FMRadioHalControl::handleCommandFinished(int type, int result, unsigned channel, qint64 time)
+{
+    switch (type) {
+        case FMRadioCommand::CloseTuner:
+            if (result == 0)
+                qCDebug(log) << "Tuner closed.";
+            else
+                qCWarning(log) << "Error when closing tuner:" << result;
+            return;
+
+        case FMRadioCommand::Cancel:
+            if (result != 0)
+                qCWarning(log) << "Failed to cancel:" << result;
+            return;
+
+        default: break;
+    }
+
+    if (result == 0)
+        return;
+
+    m_hal->stats.count(FMRadioStats::CommandFailures);
+
+    switch (type) {
+        case FMRadioCommand::SetConfiguration:
+            qCWarning(log) << "Failed to set configuration:" << result;
+            break;
+
+        case FMRadioCommand::Tune:
+            qCWarning(log) << "Radio tune failed:" << result;
+            m_hal->trace.cancel(FMRadioTraceLog::Tune);
+            m_hal->trace.start(FMRadioTraceLog::Tune, time, result);
+            if (m_tuneInProgress && channel == m_currentFreq) {
+                m_tuneInProgress = false;
+                m_tuneTimer->stop();
+            }
+            break;
+
+        case FMRadioCommand::SearchTune:
+            qCWarning(log) << "Radio tune failed:" << result;
+            if (m_searchCandidate >= 0 && m_searchCandidate < m_searchCandidates.size()
+                && m_searchCandidates.at(m_searchCandidate) == channel)
+                nextSearchCandidate();
+            break;
+
+        case FMRadioCommand::Scan:
+            qCWarning(log) << "Failed to scan:" << result;
+            m_hal->trace.cancel(FMRadioTraceLog::Seek);
+            m_hal->trace.start(FMRadioTraceLog::Seek, time, result);
+            m_seekClock.invalidate();
+            // Search all is ended by the seek watchdog
+            if (!m_searchAll)
+                setSearching(false);
+            break;
+
+        default: break;
+    }
 }
 
 void FMRadioHalControl::handleConfig(int band, bool stereo)
@@ -560,35 +1931,230 @@ void FMRadioHalControl::handleConfig(int band, bool stereo)
     if (!m_tunerReady) {
         qCDebug(log) << "Initial tuner config received.";
         m_tunerReady = true;
-        setError(QRadioTuner::NoError);
-        setTuning();
-        emit stateChanged(QRadioTuner::ActiveState);
+        // Callback may come before open_tuner() has returned
+        if (m_hal->tuner)
+            handleTunerReady();
     }
 
-    if (static_cast<radio_band_t>(band) == RADIO_BAND_FM)
+    if (static_cast<radio_band_t>(band) == m_hal->config.type)
         setStereoEnabled(stereo);
 }
 
-void FMRadioHalControl::handleAntenna(bool connected)
+void FMRadioHalControl::handleTunerReady()
+{
+    bool resumed = m_suspended;
+
+    m_suspended = false;
+    setError(QRadioTuner::NoError);
+    setTuning();
+    updateSignalSampling();
+    updateIdle();
+    updateBackgroundScan();
+
+    if (m_recoveryAttempts > 0) {
+        qint64 time = FMRadioTraceLog::now();
+        m_hal->trace.finish(FMRadioTraceLog::Recovery, m_currentFreq, time);
+        qCDebug(log) << "Tuner recovered after" << m_recoveryAttempts << "attempts.";
+        // Search is resumed once tuned back to where it was
+        if (!m_resumeSearch)
+            stopRecovery();
+    }
+
+    if (!resumed)
+        emit stateChanged(QRadioTuner::ActiveState);
+
+    // Muted or unmuted while opening
+    if (m_tunerAudio != audioWanted())
+        QMetaObject::invokeMethod(this, "updateAudio", Qt::QueuedConnection);
+}
+
+void FMRadioHalControl::handleAntenna(bool connected)
+{
+    if (connected != m_antennaConnected) {
+        m_antennaConnected = connected;
+        qCDebug(log) << "Antenna changes to " << (m_antennaConnected ? "connected" : "disconnected");
+        emit antennaConnectedChanged(m_antennaConnected);
+    }
+}
+
+// Searches measure every channel into the scan table, otherwise the
+// station is the one listened to.
+void FMRadioHalControl::updateCachedStation(unsigned channel, bool add)
+{
+    int signalStrength = m_signalStrength;
+    bool stereo = m_stereoEnabled;
+
+    if (m_searchAll)
+        m_hal->scanTable.reception(channel, &signalStrength, &stereo);
+
+    m_hal->stations.update(channel, m_stationId, m_stationName, m_programType,
+                           signalStrength, stereo, add);
+}
+
+void FMRadioHalControl::searchChannelFound(unsigned channel)
+{
+    if (m_searchMode == QRadioTuner::SearchFast) {
+        qCDebug(log) << "SearchFast found channel" << channel;
+        emit stationFound(FREQ_HAL_TO_QT(channel), m_stationId);
+        updateCachedStation(channel, true);
+    } else {
+        qCDebug(log) << "SearchGetStationId candidate channel" << channel;
+        m_searchCandidates.append(channel);
+    }
+}
+
+void FMRadioHalControl::startSearchCandidates()
+{
+    qCDebug(log) << "SearchGetStationId scan done, get RDS for" << m_searchCandidates.size() << "channels.";
+    m_searchCandidate = -1;
+    nextSearchCandidate();
+}
+
+void FMRadioHalControl::nextSearchCandidate()
+{
+    m_searchWaitForRDS = false;
+    m_seekTimer->stop();
+
+    if (!m_hal->tuner)
+        return;
+
+    // Failed tune continues with the next candidate
+    if (++m_searchCandidate < m_searchCandidates.size()) {
+        resetRDS();
+
+        FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::SearchTune, m_hal->tuner);
+        command.channel = m_searchCandidates.at(m_searchCandidate);
+        m_hal->worker.post(command);
+        m_hal->stats.count(FMRadioStats::Tunes);
+        m_seekTimer->start(seekTimeout());
+        return;
+    }
+
+    if (!m_searchVerify)
+        m_hal->stations.setScanComplete(m_searchMode);
+
+    m_searchAll = false;
+    m_searchAllLast = false;
+    m_searchCandidates.clear();
+    m_searchCandidate = -1;
+    m_searchVerify = false;
+    setSearching(false);
+    qCDebug(log) << "Search done.";
+
+    updateAlternativeFrequencyTable();
+    emit stationListChanged();
+    emit frequencyChanged(FREQ_HAL_TO_QT(m_currentFreq));
+}
+
+void FMRadioHalControl::searchCandidateDone(bool piReceived)
+{
+    if (m_searchVerify) {
+        FMRadioStationCache::Locker locker(&m_hal->stations);
+        unsigned channel = m_searchCandidates.at(m_searchCandidate);
+        int index = m_hal->stations.indexOf(channel);
+
+        // Cached station is gone if it had station id before but not anymore
+        if (index >= 0 && !piReceived && m_hal->stations.at(index).stationId[0] != '\0') {
+            qCDebug(log) << "Cached channel" << channel << "not found anymore.";
+            m_hal->stations.remove(channel);
+            m_hal->scanTable.remove(channel);
+        } else {
+            updateCachedStation(channel, false);
+            m_hal->scanTable.setStationId(channel, m_stationId);
+        }
+    } else {
+        qCDebug(log) << "SearchGetStationId found channel" << m_currentFreq << ":" << m_stationId;
+        m_hal->scanTable.setStationId(m_currentFreq, m_stationId);
+        emit stationFound(FREQ_HAL_TO_QT(m_currentFreq), m_stationId);
+        updateCachedStation(m_currentFreq, true);
+    }
+
+    nextSearchCandidate();
+}
+
+void FMRadioHalControl::searchPiReceived()
+{
+    int latency = static_cast<int>(m_searchDwell.elapsed());
+
+    // Only received PIs are learned, missing PI is a normal outcome.
+    m_hal->timings.addTiming(FMRadioTimingCache::StationIdTime, latency);
+    m_searchPiTimeout = stationIdTimeout();
+    qCDebug(log) << "SearchGetStationId PI received in" << latency << "ms, timeout now" << m_searchPiTimeout << "ms";
+}
+
+int FMRadioHalControl::seekTimeout() const
+{
+    int p99 = m_hal->timings.timingPercentile(FMRadioTimingCache::SeekTime, 99);
+
+    if (p99 < 0)
+        return SEARCH_SCAN_TIMEOUT_MS;
+
+    return qMax(SEARCH_SCAN_TIMEOUT_MS, p99 + SEARCH_SCAN_MARGIN_MS);
+}
+
+int FMRadioHalControl::stationIdTimeout() const
+{
+    int p99 = m_hal->timings.timingPercentile(FMRadioTimingCache::StationIdTime, 99);
+
+    if (p99 < 0)
+        return SEARCH_PI_TIMEOUT_MS;
+
+    return qBound(SEARCH_PI_MIN_TIMEOUT_MS, p99 + SEARCH_PI_MARGIN_MS, SEARCH_SCAN_TIMEOUT_MS);
+}
+
+void FMRadioHalControl::seekDone(bool timeout)
 {
-    if (connected != m_antennaConnected) {
-        m_antennaConnected = connected;
-        qCDebug(log) << "Antenna changes to " << (m_antennaConnected ? "connected" : "disconnected");
-        emit antennaConnectedChanged(m_antennaConnected);
-    }
+    if (!m_seekClock.isValid())
+        return;
+
+    // Timeouts are learned as well so that a too short timeout grows
+    // back on slow devices.
+    int elapsed = static_cast<int>(m_seekClock.elapsed());
+    m_hal->timings.addTiming(FMRadioTimingCache::SeekTime, elapsed);
+    m_seekClock.invalidate();
+
+    qCDebug(log) << "Seek" << (timeout ? "timed out" : "done") << "in" << elapsed << "ms";
 }
 
-bool FMRadioHalControl::tunedSearchAll(unsigned channel)
+bool FMRadioHalControl::tunedSearchAll(unsigned channel, bool stereo, bool tuned)
 {
     unsigned channelRelative = channel - m_hal->config.lower_limit;
     int reduce;
 
-    if (m_firstFoundFrequency > 0) {
-        if (m_searchMode == QRadioTuner::SearchFast) {
-            qCDebug(log) << "SearchFast found channel" << channel;
-            emit stationFound(FREQ_HAL_TO_QT(channel), m_stationId);
+    // Signal strength was updated from the same event just before.
+    if (tuned)
+        m_hal->scanTable.update(channel, m_signalStrength, stereo);
+
+    if (m_searchCandidate >= 0) {
+        if (m_searchVerify) {
+            unsigned candidate = m_searchCandidates.at(m_searchCandidate);
+            int index = m_hal->stations.indexOf(candidate);
+
+            if (!tuned || index < 0) {
+                qCDebug(log) << "Cached channel" << candidate << "not found anymore.";
+                m_hal->stations.remove(candidate);
+                m_hal->scanTable.remove(candidate);
+                nextSearchCandidate();
+                return true;
+            }
+
+            // Nothing more to verify for stations without station id
+            if (m_searchMode == QRadioTuner::SearchFast || m_hal->stations.at(index).stationId[0] == '\0') {
+                searchCandidateDone(false);
+                return true;
+            }
         }
-    } else
+
+        qCDebug(log) << "SearchGetStationId channel" << channel << "tuned, wait for RDS.";
+        m_searchWaitForRDS = true;
+        m_searchDwell.start();
+        m_seekTimer->start(m_searchPiTimeout);
+        return true;
+    }
+
+    if (m_firstFoundFrequency > 0)
+        searchChannelFound(channel);
+    else
         m_firstFoundFrequency = channel;
 
     if (channelRelative >= m_lastFrequency)
@@ -600,27 +2166,17 @@ bool FMRadioHalControl::tunedSearchAll(unsigned channel)
     m_searchRange -= reduce;
     m_lastFrequency = channel - m_hal->config.lower_limit;
 
-    if (m_searchMode == QRadioTuner::SearchFast) {
-        if (m_searchRange > 0) {
-            searchForward();
-            return true;
-        }
-    } else {
-        if (m_searchRange > 0) {
-            qCDebug(log) << "SearchGetStationId channel" << channel << "tuned, wait for RDS.";
-            return true;
-        }
+    if (m_searchRange > 0) {
+        searchForward();
+        return true;
     }
 
-    if (m_firstFoundFrequency != channel) {
-        if (m_searchMode == QRadioTuner::SearchFast) {
-            qCDebug(log) << "SearchFast found channel" << m_firstFoundFrequency;
-            emit stationFound(FREQ_HAL_TO_QT(m_firstFoundFrequency), m_stationId);
-        } else {
-            qCDebug(log) << "SearchGetStationId channel" << channel << "tuned, wait for RDS.";
-            m_searchAllLast = true;
-            return true;
-        }
+    if (m_firstFoundFrequency != channel)
+        searchChannelFound(m_firstFoundFrequency);
+
+    if (!m_searchCandidates.isEmpty()) {
+        startSearchCandidates();
+        return true;
     }
 
     m_searchAllLast = true;
@@ -628,21 +2184,46 @@ bool FMRadioHalControl::tunedSearchAll(unsigned channel)
     return false;
 }
 
-void FMRadioHalControl::handleTuned(unsigned channel, bool stereo)
+void FMRadioHalControl::handleTuned(unsigned channel, bool stereo, bool tuned)
 {
+    if (m_tuneInProgress) {
+        m_tuneInProgress = false;
+        m_tuneTimer->stop();
+
+        // Frequency was changed again while tuning, result is stale
+        if (m_tuneQueued) {
+            qCDebug(log) << "Tuned channel" << channel << "superseded by" << m_currentFreq;
+            resetRDS();
+            setTuning();
+            return;
+        }
+    }
+
+    seekDone(false);
+
+    if (m_resumeSearch && m_recoveryAttempts > 0) {
+        m_currentFreq = channel;
+        resumeSearch();
+        return;
+    }
+
     m_currentFreq = channel;
+    m_tuned = tuned;
 
     if (!m_searchAllLast && m_searchAll) {
-        if (tunedSearchAll(channel))
+        if (tunedSearchAll(channel, stereo, tuned))
             return;
     }
 
     if (m_searchAllLast) {
+        m_hal->stations.setScanComplete(m_searchMode);
         m_searchAllLast = false;
         m_searchAll = false;
         m_searchWaitForRDS = false;
         setSearching(false);
         qCDebug(log) << "Search done.";
+        updateAlternativeFrequencyTable();
+        emit stationListChanged();
     }
 
     qCDebug(log) << "Tuned channel" << m_currentFreq << (stereo ? "stereo" : "mono");
@@ -653,158 +2234,439 @@ void FMRadioHalControl::handleTuned(unsigned channel, bool stereo)
     setStereoEnabled(stereo);
 }
 
-// Called in radio event callback thread
-void FMRadioHalControl::handleMetadata(const radio_hal_event_t *event)
+// Called with a copy of the metadata from the radio event callback,
+// so all RDS state is only ever touched from the control thread.
+void FMRadioHalControl::handleMetadata(const radio_metadata_t *metadata, unsigned size)
 {
-    if (!event->metadata || m_rdsError != QRadioData::NoError)
+    if (m_rdsError != QRadioData::NoError)
         return;
 
-    int ret;
-    if ((ret = m_hal->metadata_check(event->metadata)) != 0) {
-        qCDebug(log) << "Radio metadata consistency check failed:" << ret;
+    bool seekNext = false;
+    bool changed = false;
+    FMRadioMetadataItem item;
+    FMRadioMetadataReader reader(metadata, size);
+
+    if (reader.isValid()) {
+        while (reader.next(item))
+            handleMetadataItem(item, &seekNext, &changed);
+
+        if (!reader.isValid())
+            qCDebug(log) << "Invalid metadata entry, rest of the packet ignored.";
+    } else if (openRadioMetadata()) {
+        int ret;
+        if ((ret = m_hal->metadata_check(metadata)) != 0) {
+            qCDebug(log) << "Radio metadata consistency check failed:" << ret;
+            m_hal->stats.count(FMRadioStats::MetadataRejected);
+            return;
+        }
+
+        int count = m_hal->metadata_get_count(metadata);
+
+        for (int i = 0; i < count; ++i) {
+            void *value;
+            unsigned int valueSize;
+
+            if ((ret = m_hal->metadata_get_at_index(metadata, i, &item.key, &item.type, &value, &valueSize)) != 0) {
+                qCDebug(log) << "Failed to get metadata from index" << i << ":" << ret;
+                break;
+            }
+
+            item.data = value;
+            item.size = valueSize;
+            handleMetadataItem(item, &seekNext, &changed);
+        }
+    } else {
+        qCDebug(log) << "Invalid metadata packet.";
+        m_hal->stats.count(FMRadioStats::MetadataRejected);
         return;
     }
 
-    unsigned count = m_hal->metadata_get_count(event->metadata);
-    if (count == 0)
-        return;
+    m_hal->stats.count(FMRadioStats::MetadataParsed);
 
-    for (unsigned i = 0; i < count; ++i) {
-        radio_metadata_key_t key;
-        radio_metadata_type_t dataType;
-        void *value;
-        unsigned size;
+    // Title and artist of the same packet go to one entry
+    if (m_rdsHistoryPending) {
+        m_rdsHistoryPending = false;
+        if (isRdsHistoryEnabled() && !m_searchAll
+            && m_hal->rdsHistory.add(QDateTime::currentMSecsSinceEpoch(), m_currentFreq,
+                                     m_hal->stationIdText, m_hal->stationNameText,
+                                     m_hal->radioText, m_hal->artistText))
+            emit rdsHistoryChanged();
+    }
 
-        if ((ret = m_hal->metadata_get_at_index(event->metadata, i, &key, &dataType, &value, &size)) != 0) {
-            qCDebug(log) << "Failed to get metadata from index" << i << ":" << ret;
-            return;
+    publishRds();
+
+    // Continue SearchGetStationId only after the whole packet is handled.
+    if (seekNext)
+        searchCandidateDone(true);
+    else if (changed && !m_searchAll && !m_stationId.isEmpty())
+        updateCachedStation(m_currentFreq, false);
+}
+
+void FMRadioHalControl::handleMetadataItem(const FMRadioMetadataItem &item, bool *seekNext, bool *changed)
+{
+    switch (item.type) {
+        case RADIO_METADATA_TYPE_TEXT: {
+            const char *text = static_cast<const char*>(item.data);
+            qCDebug(log) << "Raw data for key" << item.key << ":" << QString::fromUtf8(text, qstrnlen(text, item.size));
+
+            switch (item.key) {
+                case RADIO_METADATA_KEY_RDS_PI:
+                    if (m_hal->stationIdText.update(text, item.size)) {
+                        m_stationId = m_hal->stationIdText.toString();
+                        qCDebug(log) << "RDS_PI:" << m_stationId;
+                        *changed = true;
+                        if (m_searchWaitForRDS) {
+                            searchPiReceived();
+                            *seekNext = true;
+                        } else
+                            m_rdsChanged |= FMRadioRdsData::StationId;
+                    }
+                    break;
+
+                case RADIO_METADATA_KEY_RDS_PS:
+                    if (m_hal->stationNameText.update(text, item.size)) {
+                        m_stationName = m_hal->stationNameText.toString();
+                        qCDebug(log) << "RDS_PS:" << m_stationName;
+                        *changed = true;
+                        m_rdsChanged |= FMRadioRdsData::StationName;
+                    }
+                    break;
+
+                case RADIO_METADATA_KEY_TITLE:
+                    if (m_hal->radioText.update(text, item.size)) {
+                        m_radioText = m_hal->radioText.toString();
+                        qCDebug(log) << "TITLE:" << m_radioText;
+                        m_rdsChanged |= FMRadioRdsData::RadioText;
+                        m_rdsHistoryPending = true;
+                    }
+                    break;
+
+                case RADIO_METADATA_KEY_ARTIST:
+                    // Only needed for history, no QString needed
+                    if (isRdsHistoryEnabled() && m_hal->artistText.update(text, item.size))
+                        m_rdsHistoryPending = true;
+                    break;
+
+                default: break;
+            }
+            break;
         }
 
-        switch (dataType) {
-            case RADIO_METADATA_TYPE_TEXT: {
-                static const QRegExp regExp("[^a-zA-Z0-9 -_,;.:!#%&/()=?@£$+]");
-                QString str = QString::fromUtf8(reinterpret_cast<const char*>(value));
-                qCDebug(log) << "Raw data for key" << key << ":" << str;
-                str = str.remove(regExp).trimmed();
-
-                switch (key) {
-                    case RADIO_METADATA_KEY_RDS_PI:
-                        qCDebug(log) << "RDS_PI:" << str;
-                        if (m_stationId != str) {
-                            m_stationId = str;
-                            if (m_searchWaitForRDS) {
-                                qCDebug(log) << "SearchGetStationId found channel" << m_currentFreq << ":" << m_stationId;
-                                emit stationFound(FREQ_HAL_TO_QT(m_currentFreq), m_stationId);
-                                emit seekNextChannel();
-                            } else
-                                emit stationIdChanged(m_stationId);
-                        }
-                        break;
-
-                    case RADIO_METADATA_KEY_RDS_PS:
-                        qCDebug(log) << "RDS_PS:" << str;
-                        if (m_stationName != str) {
-                            m_stationName = str;
-                            emit stationNameChanged(m_stationName);
-                        }
-                        break;
-
-                    case RADIO_METADATA_KEY_TITLE:
-                        qCDebug(log) << "TITLE:" << str;
-                        if (m_radioText != str) {
-                            m_radioText = str;
-                            emit radioTextChanged(m_radioText);
-                        }
-                        break;
-                }
+        case RADIO_METADATA_TYPE_INT: {
+            if (item.size < sizeof(unsigned int))
                 break;
-            }
 
-            case RADIO_METADATA_TYPE_INT: {
-                const unsigned int *integer = reinterpret_cast<const unsigned int*>(value);
-
-                switch (key) {
-                    case RADIO_METADATA_KEY_RDS_PTY:
-                        if (m_programType != *integer) {
-                            qCDebug(log) << "RDS_PTY:" << *integer;
-                            m_programType = *integer;
-                            emit programTypeChanged(programTypeValue(0, m_programType));
-                            emit programTypeNameChanged(programTypeNameString(0, m_programType));
-                        }
-                        break;
-
-                    case RADIO_METADATA_KEY_RBDS_PTY:
-                        if (m_programType != *integer) {
-                            qCDebug(log) << "RBDS_PTY:" << *integer;
-                            m_programType = *integer;
-                            emit programTypeChanged(programTypeValue(1, m_programType));
-                            emit programTypeNameChanged(programTypeNameString(1, m_programType));
-                        }
-                        break;
-                }
-                break;
+            const unsigned int *integer = static_cast<const unsigned int*>(item.data);
+
+            switch (item.key) {
+                case RADIO_METADATA_KEY_RDS_PTY:
+                    if (m_programType != *integer) {
+                        qCDebug(log) << "RDS_PTY:" << *integer;
+                        m_programType = *integer;
+                        m_rdsStandard = 0;
+                        *changed = true;
+                        m_rdsChanged |= FMRadioRdsData::ProgramType;
+                    }
+                    break;
+
+                case RADIO_METADATA_KEY_RBDS_PTY:
+                    if (m_programType != *integer) {
+                        qCDebug(log) << "RBDS_PTY:" << *integer;
+                        m_programType = *integer;
+                        m_rdsStandard = 1;
+                        *changed = true;
+                        m_rdsChanged |= FMRadioRdsData::ProgramType;
+                    }
+                    break;
+
+                default: break;
             }
+            break;
         }
+
+        default: break;
+    }
+}
+
+// History is cleared when the last client disables it
+void FMRadioHalControl::setRdsHistoryEnabled(QObject *client, bool enabled)
+{
+    if (enabled) {
+        m_rdsHistoryClients.insert(client);
+        return;
+    }
+
+    if (!m_rdsHistoryClients.remove(client) || !m_rdsHistoryClients.isEmpty())
+        return;
+
+    if (m_hal->rdsHistory.count() > 0) {
+        m_hal->rdsHistory.clear();
+        emit rdsHistoryChanged();
     }
 }
 
+bool FMRadioHalControl::isRdsHistoryEnabled() const
+{
+    return !m_rdsHistoryClients.isEmpty();
+}
+
+const FMRadioRdsHistory &FMRadioHalControl::rdsHistory() const
+{
+    return m_hal->rdsHistory;
+}
+
+bool FMRadioHalControl::isTrafficAnnouncement() const
+{
+    return m_trafficAnnouncement;
+}
+
+bool FMRadioHalControl::isEmergencyAnnouncement() const
+{
+    return m_emergencyAnnouncement;
+}
+
 void FMRadioHalControl::handleTA(bool enabled)
 {
-    qCDebug(log) << "Radio TA changes to " << (enabled ? "true" : "false");
+    if (enabled != m_trafficAnnouncement) {
+        qCDebug(log) << "Radio TA changes to " << (enabled ? "true" : "false");
+        m_trafficAnnouncement = enabled;
+        emit trafficAnnouncementChanged(enabled);
+    }
 }
 
-// Alternative Frequency switch
-void FMRadioHalControl::handleAFSwitch(bool /* unused */)
+// Alternative Frequency switch, HAL moved to another channel of the
+// same programme. Keep RDS state, as PI, PS and PTY stay the same.
+void FMRadioHalControl::handleAFSwitch(unsigned channel, bool stereo)
 {
-    qCDebug(log) << "Radio AF switch";
+    qCDebug(log) << "Radio AF switch from" << m_currentFreq << "to" << channel;
+
+    if (m_searchAll || channel == m_currentFreq)
+        return;
+
+    // Channel is known to carry another programme, so the switch
+    // was not for the programme our RDS state belongs to.
+    int index = m_hal->stations.indexOf(channel);
+    if (index >= 0) {
+        QString stationId = FMRadioStationCache::stationId(m_hal->stations.at(index));
+        if (!stationId.isEmpty() && stationId != m_stationId) {
+            qCDebug(log) << "AF channel" << channel << "has PI" << stationId << "reset RDS.";
+            resetRDS();
+        }
+    }
+
+    if (!m_stationId.isEmpty()) {
+        QVector<unsigned> &channels = m_afTable[m_stationId];
+        if (!channels.contains(channel))
+            channels.append(channel);
+    }
+
+    m_currentFreq = channel;
+    m_tuned = true;
+    emit frequencyChanged(FREQ_HAL_TO_QT(m_currentFreq));
+
+    setStereoEnabled(stereo);
 }
 
 void FMRadioHalControl::handleEA(bool enabled)
 {
-    qCDebug(log) << "Radio EA changes to " << (enabled ? "true" : "false");
+    if (enabled != m_emergencyAnnouncement) {
+        qCDebug(log) << "Radio EA changes to " << (enabled ? "true" : "false");
+        m_emergencyAnnouncement = enabled;
+        emit emergencyAnnouncementChanged(enabled);
+    }
+}
+
+bool FMRadioHalControl::event(QEvent *event)
+{
+    if (event->type() != AnnouncementEvent)
+        return QObject::event(event);
+
+    // Time is read before clearing pending, after which the callback
+    // thread may store the next one.
+    qint64 time = m_hal->announcementTime.loadAcquire();
+    m_hal->announcementPending.fetchAndStoreAcquire(0);
+    int state = m_hal->announcements.loadAcquire();
+
+    // Late event of a closed tuner
+    if (!m_hal->tuner)
+        return true;
+
+    m_hal->trace.start(FMRadioTraceLog::Announcement, time, 0);
+    handleTA(state & ANNOUNCEMENT_TA);
+    handleEA(state & ANNOUNCEMENT_EA);
+    m_hal->trace.finish(FMRadioTraceLog::Announcement, m_currentFreq, FMRadioTraceLog::now());
+
+    return true;
+}
+
+// Called in radio event callback thread
+void FMRadioHalControl::announcementEvent(int type, bool on, qint64 time)
+{
+    int bit = type == RADIO_EVENT_TA ? ANNOUNCEMENT_TA : ANNOUNCEMENT_EA;
+
+    if (m_hal->announcementPending.loadAcquire() == 0)
+        m_hal->announcementTime.storeRelease(time);
+
+    // Control thread clears the state when closing the tuner
+    if (on)
+        m_hal->announcements.fetchAndOrRelease(bit);
+    else
+        m_hal->announcements.fetchAndAndRelease(~bit);
+
+    if (m_hal->announcementPending.testAndSetRelease(0, 1))
+        QCoreApplication::postEvent(this, new QEvent(AnnouncementEvent), Qt::HighEventPriority);
+}
+
+void FMRadioHalControl::handleEvents()
+{
+    FMRadioEvent event;
+
+    // Acknowledge before draining so that events pushed while
+    // we are processing will trigger a new wake up.
+    m_hal->events.acknowledge();
+
+    while (m_hal->events.pop(event)) {
+        switch (event.type) {
+            case RADIO_EVENT_HW_FAILURE:
+                handleHwFailure();
+                break;
+
+            case RADIO_EVENT_CONFIG:
+                m_hal->trace.finish(FMRadioTraceLog::OpenTuner, 0, event.time);
+                handleConfig(event.band, event.stereo);
+                break;
+
+            case RADIO_EVENT_ANTENNA:
+                handleAntenna(event.on);
+                break;
+
+            case RADIO_EVENT_TUNED:
+                m_hal->trace.finish(FMRadioTraceLog::Tune, event.channel, event.time);
+                m_hal->trace.finish(FMRadioTraceLog::Seek, event.channel, event.time);
+                updateSignalStrength(event.signalStrength, true);
+                handleTuned(event.channel, event.stereo, event.tuned);
+                break;
+
+            case RADIO_EVENT_METADATA:
+                // Measured from the oldest packet not yet delivered
+                if (!m_hal->trace.isPending(FMRadioTraceLog::Metadata))
+                    m_hal->trace.start(FMRadioTraceLog::Metadata, event.time, 0);
+                handleMetadata(static_cast<const radio_metadata_t*>(m_hal->metadata.data(event.metadata)),
+                               m_hal->metadata.size(event.metadata));
+                m_hal->metadata.release(event.metadata);
+                if (!m_rdsTimer->isActive())
+                    m_hal->trace.cancel(FMRadioTraceLog::Metadata);
+                break;
+
+            case RADIO_EVENT_AF_SWITCH:
+                updateSignalStrength(event.signalStrength, true);
+                handleAFSwitch(event.channel, event.stereo);
+                break;
+
+            default: break;
+        }
+    }
+
+    int dropped = m_hal->events.takeDropped();
+    if (dropped > 0) {
+        qCWarning(log) << "Event queue full," << dropped << "radio events dropped.";
+        m_hal->stats.count(FMRadioStats::EventsDropped, dropped);
+    }
 }
 
 // Called in radio event callback thread
 void FMRadioHalControl::radioEvent(const radio_hal_event_t *event)
 {
+    FMRadioEvent e;
+    unsigned metadataSize = 0;
+
+    e.time = FMRadioTraceLog::now();
+    e.type = event->type;
+    m_hal->stats.countEvent(e.type);
+    e.band = 0;
+    e.channel = 0;
+    e.signalStrength = 0;
+    e.on = false;
+    e.stereo = false;
+    e.tuned = false;
+    e.metadata = -1;
+
     switch (event->type) {
         case RADIO_EVENT_HW_FAILURE:
-            emit eventHwFailure();
             break;
 
         case RADIO_EVENT_CONFIG:
-            emit eventConfig(static_cast<int>(event->config.type), event->config.fm.stereo);
-            break;
-
-        case RADIO_EVENT_ANTENNA:
-            emit eventAntenna(event->on);
+            e.band = static_cast<int>(event->config.type);
+            if (event->config.type == RADIO_BAND_FM || event->config.type == RADIO_BAND_FM_HD)
+                e.stereo = event->config.fm.stereo;
+            else
+                e.stereo = event->config.am.stereo;
             break;
 
         case RADIO_EVENT_TUNED:
-            emit eventTuned(event->info.channel, event->info.stereo);
+        case RADIO_EVENT_AF_SWITCH:
+            e.channel = event->info.channel;
+            e.stereo = event->info.stereo;
+            e.tuned = event->info.tuned;
+            e.signalStrength = event->info.signal_strength;
             break;
 
         case RADIO_EVENT_METADATA:
-            handleMetadata(event);
+            // Only copy the blob here, parsing is done in control thread.
+            if (!(metadataSize = FMRadioMetadataReader::size(event->metadata))) {
+                qCDebug(log) << "Invalid metadata, dropped.";
+                m_hal->stats.count(FMRadioStats::MetadataRejected);
+                return;
+            }
+            if (m_hal->recorder.isOpen())
+                m_hal->recorder.record(e, event->metadata, metadataSize);
+            if (metadataSize > FMRadioMetadataPool::SlotSize)
+                m_hal->stats.count(FMRadioStats::MetadataLarge);
+            e.metadata = m_hal->metadata.acquire(event->metadata, metadataSize);
+            if (e.metadata < 0) {
+                qCDebug(log) << "No free metadata buffer, metadata dropped.";
+                m_hal->stats.count(FMRadioStats::EventsDropped);
+                return;
+            }
             break;
 
+        case RADIO_EVENT_ANTENNA:
         case RADIO_EVENT_TA:
-            emit eventTA(event->on);
-            break;
-
-        case RADIO_EVENT_AF_SWITCH:
-            emit eventAFSwitch(event->on);
-            break;
-
 #ifdef SUPPORT_RADIO_EVENT_EA
         case RADIO_EVENT_EA:
-            emit eventEA(event->on);
-            break;
 #endif
+            e.on = event->on;
+            break;
 
         // framework internal events
-        default: break;
+        default: return;
     };
+
+    if (m_hal->recorder.isOpen() && e.type != RADIO_EVENT_METADATA)
+        m_hal->recorder.record(e, 0, 0);
+
+    // Announcements must not wait behind RDS traffic
+    if (e.type == RADIO_EVENT_TA
+#ifdef SUPPORT_RADIO_EVENT_EA
+        || e.type == RADIO_EVENT_EA
+#endif
+        ) {
+        announcementEvent(e.type, e.on, e.time);
+        return;
+    }
+
+    bool wakeUp;
+
+    if (!m_hal->events.push(e, &wakeUp)) {
+        if (e.metadata >= 0)
+            m_hal->metadata.release(e.metadata);
+        return;
+    }
+
+    // Wake up the control thread once per batch of events,
+    // it will then drain the whole queue in one go.
+    if (wakeUp)
+        QMetaObject::invokeMethod(this, "handleEvents", Qt::QueuedConnection);
 }
 
 // Called in radio event callback thread
@@ -813,26 +2675,100 @@ void FMRadioHalControl::radioEventCallback(radio_hal_event_t *event, void *cooki
     static_cast<FMRadioHalControl*>(cookie)->radioEvent(event);
 }
 
-void FMRadioHalControl::start()
+// Tuner is shared by all clients of the control, and kept open
+// as long as any of them has it started.
+void FMRadioHalControl::start(QObject *client)
+{
+    m_tunerClients.insert(client);
+
+    if (!m_loading)
+        openTuner();
+}
+
+void FMRadioHalControl::stop(QObject *client)
+{
+    m_tunerClients.remove(client);
+
+    if (!m_tunerClients.isEmpty())
+        return;
+
+    stopRecovery();
+
+    if (m_suspended && !m_hal->tuner) {
+        m_suspended = false;
+        emit stateChanged(QRadioTuner::StoppedState);
+        return;
+    }
+
+    // Stopped for good, not suspended anymore
+    m_suspended = false;
+    closeTuner();
+}
+
+void FMRadioHalControl::openTuner()
 {
-    if (!m_hal || !m_hal->radiohw || m_hal->tuner)
+    if (!m_hal || !m_hal->radiohw || m_hal->tuner || m_tunerOpening)
         return;
 
     m_searching = false;
     m_searchAll = false;
     m_searchAllLast = false;
+    m_searchWaitForRDS = false;
+    m_searchCandidates.clear();
+    m_searchCandidate = -1;
+    m_searchVerify = false;
+
+    m_rdsDelivered = rdsWanted();
+
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::OpenTuner, 0);
+    command.time = FMRadioTraceLog::now();
+    command.device = m_hal->radiohw;
+    command.config = tunerConfig();
+    command.audio = audioWanted();
+    command.callback = &FMRadioHalControl::radioEventCallback;
+    command.cookie = this;
+    m_hal->worker.post(command);
+    m_hal->trace.start(FMRadioTraceLog::OpenTuner, command.time, 0);
+
+    m_tunerOpening = true;
+    m_tunerAudio = command.audio;
+}
+
+// First RADIO_EVENT_CONFIG may have been handled already
+void FMRadioHalControl::handleTunerOpened(int result, void *tuner, qint64 time)
+{
+    m_tunerOpening = false;
+
+    if (result != 0) {
+        qCCritical(log) << "Failed to open tuner:" << result;
+        m_hal->stats.count(FMRadioStats::CommandFailures);
+        m_hal->trace.cancel(FMRadioTraceLog::OpenTuner);
+        m_hal->trace.start(FMRadioTraceLog::OpenTuner, time, result);
+        m_tunerReady = false;
+        if (m_recoveryAttempts > 0)
+            scheduleRecovery();
+        else if (m_suspended) {
+            m_suspended = false;
+            setError(QRadioTuner::OpenError);
+            emit stateChanged(QRadioTuner::StoppedState);
+        }
+        return;
+    }
 
-    int ret = m_hal->radiohw->open_tuner(m_hal->radiohw, &m_hal->config, true,
-                                         &FMRadioHalControl::radioEventCallback, this,
-                                         &m_hal->tuner);
+    qCDebug(log) << "Tuner opened.";
+    m_hal->tuner = static_cast<const struct radio_tuner*>(tuner);
 
-    if (ret == 0)
-        qCDebug(log) << "Tuner opened.";
-    else
-        qCCritical(log) << "Failed to open tuner:" << ret;
+    // Stopped while opening
+    if (m_tunerClients.isEmpty()) {
+        closeTuner();
+        return;
+    }
+
+    if (m_tunerReady)
+        handleTunerReady();
 }
 
-void FMRadioHalControl::stop()
+void FMRadioHalControl::closeTuner()
 {
     if (!m_hal || !m_hal->radiohw || !m_hal->tuner)
         return;
@@ -840,16 +2776,26 @@ void FMRadioHalControl::stop()
     cancelSearch();
 
     m_tunerReady = false;
+    m_tuneTimer->stop();
+    m_tuneInProgress = false;
+    m_tuneQueued = false;
 
-    int ret = m_hal->radiohw->close_tuner(m_hal->radiohw, m_hal->tuner);
+    FMRadioCommand command = FMRadioWorker::command(FMRadioCommand::CloseTuner, m_hal->tuner);
+    command.device = m_hal->radiohw;
+    m_hal->worker.post(command);
     m_hal->tuner = 0;
 
-    if (ret == 0)
-        qCDebug(log) << "Tuner closed.";
-    else
-        qCWarning(log) << "Error when closing tuner:" << ret;
+    updateSignalSampling();
+    updateBackgroundScan();
+
+    m_hal->announcements.fetchAndAndOrdered(0);
+    handleTA(false);
+    handleEA(false);
+
+    m_idleTimer->stop();
 
-    emit stateChanged(QRadioTuner::StoppedState);
+    if (!m_suspended)
+        emit stateChanged(QRadioTuner::StoppedState);
 }
 
 void FMRadioHalControl::setError(QRadioTuner::Error newError)
@@ -887,6 +2833,9 @@ QString FMRadioHalControl::tunerErrorString() const
 
 QMultimedia::AvailabilityStatus FMRadioHalControl::rdsAvailability() const
 {
+    if (m_loading)
+        return QMultimedia::Busy;
+
     return isRdsAvailable() ? QMultimedia::Available : QMultimedia::ServiceMissing;
 }
 
@@ -930,13 +2879,67 @@ QString FMRadioHalControl::radioText() const
     return m_radioText;
 }
 
-void FMRadioHalControl::setAlternativeFrequenciesEnabled(bool /* unused */)
+void FMRadioHalControl::setAlternativeFrequenciesEnabled(bool enabled)
 {
+    if (enabled == m_afEnabled)
+        return;
+
+    m_afEnabled = enabled;
+
+    // Applied in handleHalOpened() when still loading
+    if (!m_loading)
+        applyAlternativeFrequencies();
 }
 
 bool FMRadioHalControl::isAlternativeFrequenciesEnabled() const
 {
-    return false;
+    return !m_loading && fmBand() && m_hal->config.fm.af;
+}
+
+void FMRadioHalControl::applyAlternativeFrequencies()
+{
+    bool af = m_afSupported && m_afEnabled;
+
+    if (af == m_hal->fmConfig.fm.af)
+        return;
+
+    m_hal->fmConfig.fm.af = af;
+
+    // Applied when switching back to FM
+    if (!fmBand())
+        return;
+
+    m_hal->config.fm.af = af;
+
+    if (m_hal->tuner)
+        setConfiguration();
+
+    qCDebug(log) << "AF" << (af ? "enabled." : "disabled.");
+    emit alternativeFrequenciesEnabledChanged(af);
+}
+
+// Channels with same PI from earlier searches, to which AF switches
+// seen while listening are added later.
+void FMRadioHalControl::updateAlternativeFrequencyTable()
+{
+    m_afTable.clear();
+
+    FMRadioStationCache::Locker locker(&m_hal->stations);
+    for (int i = 0; i < m_hal->stations.count(); ++i) {
+        const FMRadioStation &station = m_hal->stations.at(i);
+        QString stationId = FMRadioStationCache::stationId(station);
+
+        if (!stationId.isEmpty())
+            m_afTable[stationId].append(station.frequency);
+    }
+}
+
+// Other channels of the programme currently tuned
+QVector<unsigned> FMRadioHalControl::alternativeFrequencies() const
+{
+    QVector<unsigned> channels = m_afTable.value(m_stationId);
+    channels.removeAll(m_currentFreq);
+    return channels;
 }
 
 QRadioData::Error FMRadioHalControl::rdsError() const
@@ -956,6 +2959,51 @@ QString FMRadioHalControl::rdsErrorString() const
     return QStringLiteral("Unknown error.");
 }
 
+bool FMRadioHalControl::dumpTrace(const QString &path) const
+{
+    QString header = halDescription();
+
+    if (!header.isEmpty())
+        header = QStringLiteral("# ") + header + QLatin1Char('\n');
+
+    return m_hal->trace.dump(path, header);
+}
+
+QString FMRadioHalControl::halDescription() const
+{
+    if (m_loading || !m_hal->radiohw)
+        return QString();
+
+    return QString::fromLatin1("%1 %2 %3").arg(QString::fromUtf8(m_hal->properties.implementor),
+                                               QString::fromUtf8(m_hal->properties.product),
+                                               QString::fromUtf8(m_hal->properties.version));
+}
+
+void FMRadioHalControl::setStatsEnabled(bool enabled)
+{
+    m_hal->stats.setEnabled(enabled);
+}
+
+bool FMRadioHalControl::isStatsEnabled() const
+{
+    return m_hal->stats.isEnabled();
+}
+
+void FMRadioHalControl::resetStats()
+{
+    m_hal->stats.reset();
+}
+
+const FMRadioStats &FMRadioHalControl::stats() const
+{
+    return m_hal->stats;
+}
+
+QVector<FMRadioStationTable::Station> FMRadioHalControl::stationList() const
+{
+    return m_hal->scanTable.ranked();
+}
+
 QRadioData::ProgramType FMRadioHalControl::programTypeValue(int rdsStandard, unsigned int type) const
 {
     static const unsigned int rbdsTypes[] = {
@@ -1002,7 +3050,8 @@ QRadioData::ProgramType FMRadioHalControl::programTypeValue(int rdsStandard, uns
     return static_cast<QRadioData::ProgramType>(rbdsTypes[type]);
 }
 
-QString FMRadioHalControl::programTypeNameString(int rdsStandard, unsigned int type) const
+// Names are translated once here, and again when translator changes
+void FMRadioHalControl::updateProgramTypeNames()
 {
     static const char *rbdsTypes[] = {
         QT_TR_NOOP("No program type or undefined"),
@@ -1074,11 +3123,50 @@ QString FMRadioHalControl::programTypeNameString(int rdsStandard, unsigned int t
         QT_TR_NOOP("Alarm")
     };
 
+    for (int i = 0; i < ProgramTypeCount; ++i) {
+        m_programTypeNames[0][i] = tr(rdsTypes[i]);
+        m_programTypeNames[1][i] = tr(rbdsTypes[i]);
+    }
+}
+
+QString FMRadioHalControl::programTypeNameString(int rdsStandard, unsigned int type) const
+{
     if (type >= 32)
         type = 0;
 
-    if (rdsStandard == 0)
-        return tr(rdsTypes[type]);
-    else
-        return tr(rbdsTypes[type]);
+    return m_programTypeNames[rdsStandard == 0 ? 0 : 1][type];
+}
+
+bool FMRadioHalControl::eventFilter(QObject *object, QEvent *event)
+{
+    if (object == QCoreApplication::instance() && event->type() == QEvent::LanguageChange) {
+        qCDebug(log) << "Language changed, update program type names.";
+        updateProgramTypeNames();
+        emit programTypeNamesChanged();
+    }
+
+    return QObject::eventFilter(object, event);
+}
+
+FMRadioProgramInfo FMRadioHalControl::programInfo() const
+{
+    FMRadioProgramInfo info;
+
+    // Kept up to date from tuned events and signal sampling, asking the
+    // HAL here would wait behind tuning and seeking.
+    info.frequency = FREQ_HAL_TO_QT(m_currentFreq);
+    info.band = m_band;
+    info.tuned = tunerEnabled() && m_tuned;
+    info.stereo = m_stereoEnabled;
+    info.signalStrength = m_signalStrength;
+
+    info.stationId = m_stationId;
+    info.stationName = m_stationName;
+    info.radioText = m_radioText;
+    info.programType = programType();
+    info.programTypeName = programTypeName();
+    info.trafficAnnouncement = m_trafficAnnouncement;
+    info.emergencyAnnouncement = m_emergencyAnnouncement;
+
+    return info;
 }
@@ -24,15 +24,60 @@
 #include <QRadioTuner>
 #include <QRadioData>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QThread>
 #include <QAtomicInt>
 #include <QObject>
 #include <QList>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QPair>
 
 #include <system/radio.h>
 
+#include "fmradiostationtable.h"
+
 typedef struct HalPrivate HalPrivate;
 
+// RDS values after a metadata packet, and which of them it changed.
+struct FMRadioRdsData {
+    enum Field {
+        StationId   = 0x01,
+        StationName = 0x02,
+        ProgramType = 0x04,
+        RadioText   = 0x08
+    };
+
+    int changed;
+    QString stationId;
+    QString stationName;
+    QString radioText;
+    QRadioData::ProgramType programType;
+    QString programTypeName;
+};
+// Reception and RDS state of the current station in one go.
+struct FMRadioProgramInfo {
+    int frequency;          // Hz
+    QRadioTuner::Band band;
+    bool tuned;
+    bool stereo;
+    int signalStrength;
+    QString stationId;
+    QString stationName;
+    QString radioText;
+    QRadioData::ProgramType programType;
+    QString programTypeName;
+    bool trafficAnnouncement;
+    bool emergencyAnnouncement;
+};
+
+class HalOpenThread;
+struct HalOpenState;
+class FMRadioRdsHistory;
+class FMRadioStats;
+struct FMRadioMetadataItem;
+
 class FMRadioHalControl : public QObject
 {
     Q_OBJECT
@@ -45,6 +90,8 @@ public:
     QRadioTuner::Band band() const;
     void setBand(QRadioTuner::Band b);
     bool isBandSupported(QRadioTuner::Band b) const;
+    int frequencyStep(QRadioTuner::Band b) const;
+    QPair<int,int> frequencyRange(QRadioTuner::Band b) const;
 
     int frequency() const;
     void setFrequency(int frequency);
@@ -59,7 +106,7 @@ public:
     void setVolume(int volume);
 
     bool isMuted() const;
-    void setMuted(bool m_muted);
+    void setMuted(bool muted);
 
     bool isSearching() const;
 
@@ -69,8 +116,12 @@ public:
     void searchAllStations(QRadioTuner::SearchMode m_searchMode = QRadioTuner::SearchFast);
     void cancelSearch();
 
-    void start();
-    void stop();
+    void start(QObject *client);
+    void stop(QObject *client);
+
+    // RDS metadata is turned off in the HAL while there are no clients
+    void addRdsClient(QObject *client);
+    void removeRdsClient(QObject *client);
 
     QRadioTuner::Error tunerError() const;
     QString tunerErrorString() const;
@@ -89,9 +140,51 @@ public:
     QRadioData::Error rdsError() const;
     QString rdsErrorString() const;
 
+    QVector<FMRadioStationTable::Station> stationList() const;
+    QVector<unsigned> alternativeFrequencies() const;
+
+    // Write tune, seek, tuner open and RDS latencies to file
+    bool dumpTrace(const QString &path) const;
+
+    // HAL implementor, product and version, empty until opened
+    QString halDescription() const;
+
+    // Counters of HAL behaviour, off unless HALRADIO_STATS is set
+    void setStatsEnabled(bool enabled);
+    bool isStatsEnabled() const;
+    void resetStats();
+    const FMRadioStats &stats() const;
+
+    // Recent radio texts, kept while any client has enabled them
+    void setRdsHistoryEnabled(QObject *client, bool enabled);
+    bool isRdsHistoryEnabled() const;
+    const FMRadioRdsHistory &rdsHistory() const;
+
+    // RDS traffic and emergency announcements in progress
+    bool isTrafficAnnouncement() const;
+    bool isEmergencyAnnouncement() const;
+
+    // All of the above for the current station. Reception state is
+    // what the last tuned event and signal sampling reported, so no
+    // HAL call is made.
+    FMRadioProgramInfo programInfo() const;
+
+    // Keep cached stations up to date with a second tuner while
+    // playing, reported as stationAdded/Removed/Changed. Stays off
+    // when the HAL has only one tuner.
+    bool isBackgroundScanSupported() const;
+    void setBackgroundScanEnabled(bool enabled);
+    bool isBackgroundScanEnabled() const;
+
 public slots:
     void searchForward();
 
+protected:
+    bool event(QEvent *event);
+    bool eventFilter(QObject *object, QEvent *event);
+    void connectNotify(const QMetaMethod &signal);
+    void disconnectNotify(const QMetaMethod &signal);
+
 signals:
     void stateChanged(QRadioTuner::State state);
     void bandChanged(QRadioTuner::Band band);
@@ -104,68 +197,160 @@ signals:
     void error(QRadioTuner::Error err);
     void stationFound(int frequency, QString stationId);
     void antennaConnectedChanged(bool connectionStatus);
-
-    void stationIdChanged(QString stationId);
-    void programTypeChanged(QRadioData::ProgramType programType);
-    void programTypeNameChanged(QString programTypeName);
-    void stationNameChanged(QString stationName);
-    void radioTextChanged(QString radioText);
+    void stationListChanged();
+    void rdsHistoryChanged();
+    void trafficAnnouncementChanged(bool active);
+    void emergencyAnnouncementChanged(bool active);
+    void programTypeNamesChanged();
+    void stationAdded(int frequency, QString stationId);
+    void stationRemoved(int frequency);
+    void stationChanged(int frequency, QString stationId);
+
+    void rdsUpdated(const FMRadioRdsData &rds);
     void alternativeFrequenciesEnabledChanged(bool enabled);
     void error(QRadioData::Error err);
 
-    // Signals used internally
-    void eventHwFailure();
-    void eventConfig(int band, bool stereo);
-    void eventAntenna(bool connected);
-    void eventTuned(unsigned channel, bool stereo);
-    void eventTA(bool enabled);
-    void eventAFSwitch(bool enabled);
-    void eventEA(bool enabled);
-    void seekNextChannel();
-
 private slots:
     void handleSeekTimeout();
+    void handleEvents();
+    void handleHalOpened();
+    void handleSignalTimeout();
+    void handleRdsTimeout();
+    void handleTuneTimeout();
+    void handleCommandFinished(int type, int result, unsigned channel, qint64 time);
+    void handleTunerOpened(int result, void *tuner, qint64 time);
+    void handleProgramInformation(int result, unsigned channel, unsigned signalStrength);
+    void handleIdleTimeout();
+    void updateAudio();
+    void handleRecoveryTimeout();
+    void handleStationAdded(unsigned channel, const QString &stationId);
+    void handleStationRemoved(unsigned channel);
+    void handleStationChanged(unsigned channel, const QString &stationId);
+
+private:
+    friend class HalOpenThread;
 
     void handleHwFailure();
+    void scheduleRecovery();
+    void stopRecovery();
+    void resumeSearch();
+    void startOpenRadio();
     void handleConfig(int band, bool stereo);
+    void handleTunerReady();
     void handleAntenna(bool connected);
-    void handleTuned(unsigned channel, bool stereo);
+    void handleTuned(unsigned channel, bool stereo, bool tuned);
     void handleTA(bool enabled);
-    void handleAFSwitch(bool enabled);
+    void handleAFSwitch(unsigned channel, bool stereo);
     void handleEA(bool enabled);
-
-private:
-    void openRadio();
-    bool setRadioConfig(radio_band_t band, radio_deemphasis_t deemphasis);
-    void setRadioConfigFallback();
+    void announcementEvent(int type, bool on, qint64 time);
+
+    bool stereoWanted() const;
+    bool autoMonoEnabled() const;
+    void applyStereoMode();
+    void updateAutoMono();
+
+    void openRadio(HalOpenState &state);
+    void finishOpenRadio();
+    void openStationCache();
+    bool fmBand() const;
+    int halBandIndex(QRadioTuner::Band b) const;
+    bool selectBand(QRadioTuner::Band b);
+    const radio_hal_band_config_t *bandConfig(QRadioTuner::Band b) const;
+    void updateAlternativeFrequencyTable();
+    void applyAlternativeFrequencies();
+    static bool setRadioConfig(HalOpenState &state, radio_band_t band, radio_region_t region);
+    static QString halCacheName(const radio_hal_properties_t &properties);
+    static QString configCachePath(const radio_hal_properties_t &properties, radio_region_t region);
+    static bool loadRadioConfig(HalOpenState &state, const QString &path);
+    static void saveRadioConfig(const radio_hal_band_config_t &config, const QString &path);
+    static void setRadioConfigFallback(radio_hal_band_config_t &config);
     void closeRadio();
-    void openRadioMetadata();
+    void openTuner();
+    void closeTuner();
+    bool openRadioMetadata();
+    void closeRadioMetadata();
     void setTuning();
+    void scheduleTuning();
+    void setConfiguration();
+    radio_hal_band_config_t tunerConfig() const;
+    bool rdsWanted() const;
+    void updateRdsDelivery();
+    bool audioWanted() const;
+    bool tunerIdle() const;
+    void updateIdle();
+    void resumeTuner();
+    void updateBackgroundScan();
     void radioEvent(const radio_hal_event_t *event);
     static void radioEventCallback(radio_hal_event_t *event, void *cookie);
-    void handleMetadata(const radio_hal_event_t *event);
-    bool tunedSearchAll(unsigned channel);
+    void handleMetadata(const radio_metadata_t *metadata, unsigned size);
+    void handleMetadataItem(const FMRadioMetadataItem &item, bool *seekNext, bool *changed);
+    bool tunedSearchAll(unsigned channel, bool stereo, bool tuned);
+    bool stationCacheValid() const;
+    void searchFromCache();
+    void updateCachedStation(unsigned channel, bool add);
+    void searchChannelFound(unsigned channel);
+    void startSearchCandidates();
+    void nextSearchCandidate();
+    void searchCandidateDone(bool piReceived);
+    void searchPiReceived();
+    int seekTimeout() const;
+    int stationIdTimeout() const;
+    void seekDone(bool timeout);
     bool tunerEnabled() const;
     void seek(radio_direction_t direction);
     void resetRDS();
+    void publishRds();
     void setSearching(bool searching);
     void setStereoEnabled(bool enabled);
+    void updateSignalSampling();
+    void updateSignalStrength(unsigned strength, bool reset);
     QRadioData::ProgramType programTypeValue(int rdsStandard, unsigned int type) const;
     QString programTypeNameString(int rdsStandard, unsigned int type) const;
+    void updateProgramTypeNames();
 
     void setError(QRadioTuner::Error error);
     void setRdsError(QRadioData::Error error);
 
     HalPrivate *m_hal;
+    HalOpenThread *m_openThread;
+    bool m_loading;
+    QSet<QObject*> m_tunerClients;
     QRadioTuner::Error m_error;
     QRadioData::Error m_rdsError;
     bool m_tunerReady;
     bool m_antennaConnected;
     bool m_stereoEnabled;
     unsigned m_currentFreq;
+    bool m_tuned;           // station found at m_currentFreq
+    QRadioTuner::Band m_band;
+    QRadioTuner::StereoMode m_stereoMode;
+    bool m_stereoSupported;
+    bool m_autoMono;
+    int m_volume;
+    bool m_muted;
+    QTimer *m_tuneTimer;
+    bool m_tuneInProgress;
+    bool m_tuneQueued;
+    bool m_tunerOpening;
+    bool m_tunerAudio;      // tuner opened with audio output
+    QTimer *m_idleTimer;
+    bool m_suspended;
+    QSet<QObject*> m_rdsClients;
+    bool m_rdsDelivered;
+
+    // HW failure recovery, and search interrupted by the failure
+    QTimer *m_recoveryTimer;
+    int m_recoveryAttempts;
+    bool m_resumeSearch;
+    QVector<unsigned> m_resumeCandidates;
+    int m_resumeCandidate;
+    bool m_resumeVerify;
 
     QRadioTuner::SearchMode m_searchMode;
     QTimer *m_seekTimer;
+    QTimer *m_signalTimer;
+    int m_signalLevel;
+    int m_signalStrength;
     bool m_searching;
     bool m_searchAll;
     bool m_searchAllLast;
@@ -173,11 +358,36 @@ private:
     unsigned m_firstFoundFrequency;
     int m_searchRange;
     unsigned m_lastFrequency;
+    QVector<unsigned> m_searchCandidates;
+    int m_searchCandidate;
+    bool m_searchVerify;
+    QElapsedTimer m_searchDwell;
+    QElapsedTimer m_seekClock;
+    int m_searchPiTimeout;
+    bool m_backgroundScanEnabled;
 
     QString m_stationId;
     QString m_stationName;
     unsigned m_programType;
     QString m_radioText;
+    int m_rdsStandard;
+    int m_rdsChanged;
+    QTimer *m_rdsTimer;
+    int m_rdsInterval;
+    QElapsedTimer m_rdsClock;
+    QSet<QObject*> m_rdsHistoryClients;
+    bool m_rdsHistoryPending;
+    bool m_trafficAnnouncement;
+    bool m_emergencyAnnouncement;
+
+    // translated names of RDS (0) and RBDS (1) program types
+    enum { ProgramTypeCount = 32 };
+    QString m_programTypeNames[2][ProgramTypeCount];
+
+    bool m_afSupported;
+    bool m_afEnabled;
+    // channels known to carry the same programme, by PI
+    QHash<QString, QVector<unsigned> > m_afTable;
 };
 
 
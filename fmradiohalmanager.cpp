@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiohalmanager.h"
+#include "fmradiohalcontrol.h"
+
+#include <QDebug>
+
+#define HAL_GRACE_PERIOD_MS     (5 * 1000)
+
+FMRadioHalManager::FMRadioHalManager(QObject *parent)
+    : QObject(parent)
+    , m_control(0)
+    , m_users(0)
+    , m_graceTimer(new QTimer(this))
+{
+    bool ok;
+    int gracePeriod = qgetenv("HALRADIO_GRACE_PERIOD_MS").toInt(&ok);
+
+    m_graceTimer->setInterval(ok && gracePeriod >= 0 ? gracePeriod : HAL_GRACE_PERIOD_MS);
+    m_graceTimer->setSingleShot(true);
+    connect(m_graceTimer, SIGNAL(timeout()),
+            this, SLOT(handleGraceTimeout()));
+}
+
+FMRadioHalManager::~FMRadioHalManager()
+{
+    delete m_control;
+}
+
+FMRadioHalControl *FMRadioHalManager::acquire()
+{
+    m_graceTimer->stop();
+
+    if (!m_control)
+        m_control = new FMRadioHalControl;
+
+    m_users++;
+
+    return m_control;
+}
+
+void FMRadioHalManager::release(FMRadioHalControl *control)
+{
+    if (!control || control != m_control || m_users == 0)
+        return;
+
+    if (--m_users == 0)
+        m_graceTimer->start();
+}
+
+void FMRadioHalManager::handleGraceTimeout()
+{
+    if (m_users > 0)
+        return;
+
+    qDebug("Closing unused FM Radio HAL...");
+    delete m_control;
+    m_control = 0;
+}
@@ -0,0 +1,51 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOHALMANAGER_H
+#define __FMRADIOHALMANAGER_H
+
+#include <QObject>
+#include <QTimer>
+
+class FMRadioHalControl;
+
+// Keeps one FMRadioHalControl for all media services of the process.
+// The control is kept around for a grace period after the last service
+// releases it, so that opening the radio again is instant.
+class FMRadioHalManager : public QObject
+{
+    Q_OBJECT
+public:
+    FMRadioHalManager(QObject *parent = 0);
+    ~FMRadioHalManager();
+
+    FMRadioHalControl *acquire();
+    void release(FMRadioHalControl *control);
+
+private slots:
+    void handleGraceTimeout();
+
+private:
+    FMRadioHalControl *m_control;
+    int m_users;
+    QTimer *m_graceTimer;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiometadata.h"
+
+// In units of unsigned int
+#define HEADER_SIZE         4   // channel, sub_channel, size_int, count
+#define ENTRY_HEADER_SIZE   3   // key, type, size
+#define MAX_SIZE            (256 * 1024)
+
+#define HEADER_SIZE_INT     2
+#define HEADER_COUNT        3
+
+FMRadioMetadataReader::FMRadioMetadataReader(const radio_metadata_t *metadata, unsigned size)
+    : m_buffer(reinterpret_cast<const unsigned int*>(metadata))
+    , m_end(0)
+    , m_count(0)
+    , m_index(0)
+    , m_valid(false)
+{
+    if (size < HEADER_SIZE * sizeof(unsigned int))
+        return;
+
+    unsigned metadataSize = FMRadioMetadataReader::size(metadata);
+
+    if (metadataSize == 0 || metadataSize > size)
+        return;
+
+    unsigned sizeInt = m_buffer[HEADER_SIZE_INT];
+    m_count = m_buffer[HEADER_COUNT];
+
+    if (m_count > sizeInt - HEADER_SIZE) {
+        m_count = 0;
+        return;
+    }
+
+    m_end = sizeInt - m_count;
+    m_valid = true;
+}
+
+bool FMRadioMetadataReader::isValid() const
+{
+    return m_valid;
+}
+
+unsigned FMRadioMetadataReader::count() const
+{
+    return m_count;
+}
+
+bool FMRadioMetadataReader::next(FMRadioMetadataItem &item)
+{
+    if (!m_valid || m_index >= m_count)
+        return false;
+
+    unsigned offset = m_buffer[m_end + m_count - 1 - m_index];
+
+    if (offset < HEADER_SIZE || offset > m_end - ENTRY_HEADER_SIZE) {
+        m_valid = false;
+        return false;
+    }
+
+    const unsigned int *entry = m_buffer + offset;
+    unsigned size = entry[2];
+
+    if (size > (m_end - offset - ENTRY_HEADER_SIZE) * sizeof(unsigned int)) {
+        m_valid = false;
+        return false;
+    }
+
+    item.key = static_cast<radio_metadata_key_t>(entry[0]);
+    item.type = static_cast<radio_metadata_type_t>(entry[1]);
+    item.data = entry + ENTRY_HEADER_SIZE;
+    item.size = size;
+
+    ++m_index;
+
+    return true;
+}
+
+unsigned FMRadioMetadataReader::size(const radio_metadata_t *metadata)
+{
+    if (!metadata)
+        return 0;
+
+    unsigned sizeInt = reinterpret_cast<const unsigned int*>(metadata)[HEADER_SIZE_INT];
+
+    if (sizeInt < HEADER_SIZE || sizeInt > MAX_SIZE / sizeof(unsigned int))
+        return 0;
+
+    return sizeInt * sizeof(unsigned int);
+}
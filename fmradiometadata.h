@@ -0,0 +1,64 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOMETADATA_H
+#define __FMRADIOMETADATA_H
+
+#include <android-config.h>
+#include <system/radio_metadata.h>
+
+struct FMRadioMetadataItem {
+    radio_metadata_key_t key;
+    radio_metadata_type_t type;
+    const void *data;   // points into the metadata buffer
+    unsigned size;
+};
+
+// Single pass reader for radio_metadata_t buffers, following the layout
+// libradio_metadata uses: header, entries, and entry offsets stored
+// backwards from the end of the buffer. Every entry is bounds checked
+// before it is handed out.
+class FMRadioMetadataReader
+{
+public:
+    // size is the number of bytes available in the buffer
+    FMRadioMetadataReader(const radio_metadata_t *metadata, unsigned size);
+
+    // Header is consistent with the buffer size.
+    bool isValid() const;
+
+    // Returns false when all items are read or an invalid entry is
+    // found, which then makes isValid() false.
+    bool next(FMRadioMetadataItem &item);
+
+    unsigned count() const;
+
+    // Size of metadata in bytes from the header, or 0 if it is not sane.
+    static unsigned size(const radio_metadata_t *metadata);
+
+private:
+    const unsigned int *m_buffer;
+    unsigned m_end;     // first index slot, in units of int
+    unsigned m_count;
+    unsigned m_index;
+    bool m_valid;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiordshistory.h"
+
+#include <string.h>
+
+// Length of text that fits in size with the terminator, cut at an UTF-8
+// character boundary.
+static size_t fitLength(const FMRadioRdsText &text, size_t size)
+{
+    size_t length = static_cast<size_t>(text.length());
+
+    if (length < size)
+        return length;
+
+    length = size - 1;
+    while (length > 0 && (static_cast<uchar>(text.data()[length]) & 0xc0) == 0x80)
+        --length;
+
+    return length;
+}
+
+static void copyText(char *dest, size_t size, const FMRadioRdsText &text)
+{
+    size_t length = fitLength(text, size);
+
+    memcpy(dest, text.data(), length);
+    memset(dest + length, 0, size - length);
+}
+
+static bool sameText(const char *value, size_t size, const FMRadioRdsText &text)
+{
+    size_t length = fitLength(text, size);
+
+    return qstrnlen(value, size) == length && memcmp(value, text.data(), length) == 0;
+}
+
+FMRadioRdsHistory::FMRadioRdsHistory()
+    : m_first(0)
+    , m_count(0)
+{
+}
+
+bool FMRadioRdsHistory::add(qint64 time, unsigned frequency,
+                            const FMRadioRdsText &stationId, const FMRadioRdsText &stationName,
+                            const FMRadioRdsText &title, const FMRadioRdsText &artist)
+{
+    if (title.length() == 0 && artist.length() == 0)
+        return false;
+
+    // Stations repeat the same text, store it only once
+    for (int i = m_count - 1; i >= 0; --i) {
+        const Entry &entry = at(i);
+        if (entry.frequency != frequency)
+            continue;
+        if (sameText(entry.title, sizeof(entry.title), title)
+            && sameText(entry.artist, sizeof(entry.artist), artist))
+            return false;
+        break;
+    }
+
+    Entry *entry;
+    if (m_count < Capacity)
+        entry = &m_entries[(m_first + m_count++) % Capacity];
+    else {
+        entry = &m_entries[m_first];
+        m_first = (m_first + 1) % Capacity;
+    }
+
+    entry->time = time;
+    entry->frequency = frequency;
+    copyText(entry->stationId, sizeof(entry->stationId), stationId);
+    copyText(entry->stationName, sizeof(entry->stationName), stationName);
+    copyText(entry->title, sizeof(entry->title), title);
+    copyText(entry->artist, sizeof(entry->artist), artist);
+
+    return true;
+}
+
+void FMRadioRdsHistory::clear()
+{
+    m_first = 0;
+    m_count = 0;
+}
+
+int FMRadioRdsHistory::count() const
+{
+    return m_count;
+}
+
+const FMRadioRdsHistory::Entry &FMRadioRdsHistory::at(int index) const
+{
+    return m_entries[(m_first + index) % Capacity];
+}
+
+QString FMRadioRdsHistory::text(const char *value, unsigned size)
+{
+    return QString::fromUtf8(value, qstrnlen(value, size));
+}
@@ -0,0 +1,66 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIORDSHISTORY_H
+#define __FMRADIORDSHISTORY_H
+
+#include "fmradiordstext.h"
+
+#include <QtGlobal>
+
+// Recently received RDS texts, oldest overwritten first. All entries
+// live in a fixed array, so adding them never allocates and memory use
+// stays the same however long the radio plays.
+class FMRadioRdsHistory
+{
+public:
+    static const int Capacity = 64;
+
+    struct Entry {
+        qint64 time;            // ms since epoch
+        unsigned frequency;     // kHz
+        char stationId[8];
+        char stationName[24];
+        char title[FMRadioRdsText::Capacity];
+        char artist[64];
+    };
+
+    FMRadioRdsHistory();
+
+    // Adds entry unless title and artist are the same as in the latest
+    // entry of the station. Returns true if entry was added.
+    bool add(qint64 time, unsigned frequency,
+             const FMRadioRdsText &stationId, const FMRadioRdsText &stationName,
+             const FMRadioRdsText &title, const FMRadioRdsText &artist);
+    void clear();
+
+    // Entries from oldest (0) to newest.
+    int count() const;
+    const Entry &at(int index) const;
+
+    static QString text(const char *value, unsigned size);
+
+private:
+    Entry m_entries[Capacity];
+    int m_first;
+    int m_count;
+};
+
+#endif
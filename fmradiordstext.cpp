@@ -0,0 +1,126 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiordstext.h"
+
+#include <string.h>
+
+#define D 0 // drop
+#define K 1 // keep
+#define L 2 // lead byte of U+00A3 (pound sign)
+
+// Allowed text is U+0020 - U+005F, a - z and the pound sign.
+static const unsigned char charClass[256] = {
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0x00
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0x10
+    K, K, K, K, K, K, K, K, K, K, K, K, K, K, K, K,   // 0x20
+    K, K, K, K, K, K, K, K, K, K, K, K, K, K, K, K,   // 0x30
+    K, K, K, K, K, K, K, K, K, K, K, K, K, K, K, K,   // 0x40
+    K, K, K, K, K, K, K, K, K, K, K, K, K, K, K, K,   // 0x50
+    D, K, K, K, K, K, K, K, K, K, K, K, K, K, K, K,   // 0x60
+    K, K, K, K, K, K, K, K, K, K, K, D, D, D, D, D,   // 0x70
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0x80
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0x90
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xA0
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xB0
+    D, D, L, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xC0
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xD0
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xE0
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,   // 0xF0
+};
+
+#undef D
+#undef K
+#undef L
+
+FMRadioRdsText::FMRadioRdsText()
+    : m_length(0)
+{
+}
+
+// Equivalent of QString::fromUtf8(text).remove(QRegExp("[^a-zA-Z0-9 -_,;.:!#%&/()=?@£$+]")).trimmed()
+// Any byte outside of the allowed set is removed, this removes also all
+// multi-byte UTF-8 sequences and invalid input except for the pound sign.
+unsigned FMRadioRdsText::sanitize(const char *text, unsigned size)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char*>(text);
+    unsigned length = 0;
+    unsigned trimmed = 0;
+
+    for (unsigned i = 0; i < size && in[i] != '\0' && length < Capacity - 1; ++i) {
+        switch (charClass[in[i]]) {
+            case 1:
+                // skip leading whitespace
+                if (length == 0 && in[i] == ' ')
+                    break;
+                m_scratch[length++] = in[i];
+                if (in[i] != ' ')
+                    trimmed = length;
+                break;
+
+            case 2:
+                if (i + 1 < size && in[i + 1] == 0xa3) {
+                    m_scratch[length++] = in[i++];
+                    m_scratch[length++] = in[i];
+                    trimmed = length;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    // drop trailing whitespace
+    return trimmed;
+}
+
+bool FMRadioRdsText::update(const char *text, unsigned size)
+{
+    unsigned length = sanitize(text, size);
+
+    if (length == m_length && memcmp(m_scratch, m_value, length) == 0)
+        return false;
+
+    memcpy(m_value, m_scratch, length);
+    m_length = length;
+
+    return true;
+}
+
+void FMRadioRdsText::clear()
+{
+    m_length = 0;
+}
+
+QString FMRadioRdsText::toString() const
+{
+    return QString::fromUtf8(m_value, m_length);
+}
+
+const char *FMRadioRdsText::data() const
+{
+    return m_value;
+}
+
+unsigned FMRadioRdsText::length() const
+{
+    return m_length;
+}
@@ -0,0 +1,55 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIORDSTEXT_H
+#define __FMRADIORDSTEXT_H
+
+#include <QString>
+
+// Sanitized RDS text value. Text is filtered to the same character set
+// the plugin has always accepted, without allocating, and a QString is
+// only built when the filtered text differs from the previous value.
+class FMRadioRdsText
+{
+public:
+    static const unsigned Capacity = 256;
+
+    FMRadioRdsText();
+
+    // Filter UTF-8 text of at most size bytes. Returns true if the
+    // result differs from the current value, which is then updated.
+    bool update(const char *text, unsigned size);
+    void clear();
+
+    QString toString() const;
+
+    // Filtered UTF-8 bytes, not null terminated.
+    const char *data() const;
+    unsigned length() const;
+
+private:
+    unsigned sanitize(const char *text, unsigned size);
+
+    char m_scratch[Capacity];
+    char m_value[Capacity];
+    unsigned m_length;
+};
+
+#endif
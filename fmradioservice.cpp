@@ -21,44 +21,110 @@
 #include "fmradioservice.h"
 #include "fmradiotunercontrol.h"
 #include "fmradiodatacontrol.h"
+#include "fmradioextensioncontrol.h"
 #include "fmradiohalcontrol.h"
+#include "fmradiohalmanager.h"
 
 #include <QDebug>
 
 QT_BEGIN_NAMESPACE
 
-FMRadioService::FMRadioService(QObject *parent):
-   QMediaService(parent)
+// Controls are created on first request and deleted when released as
+// many times as requested. HAL control is held while any control exists,
+// and the tuner is closed by the HAL control once no tuner control
+// has it started.
+FMRadioService::FMRadioService(FMRadioHalManager *manager, QObject *parent):
+   QMediaService(parent),
+   m_halManager(manager),
+   m_tunerControl(0),
+   m_dataControl(0),
+   m_extensionControl(0),
+   m_halControl(0),
+   m_tunerRefs(0),
+   m_dataRefs(0),
+   m_extensionRefs(0)
 {
     qDebug("Instantiating QMediaService...");
-
-    m_halControl = new FMRadioHalControl;
-    m_tunerControl = new FMRadioTunerControl(this, m_halControl);
-    m_dataControl = new FMRadioDataControl(this, m_halControl);
 }
 
 FMRadioService::~FMRadioService()
 {
+    delete m_extensionControl;
     delete m_dataControl;
     delete m_tunerControl;
-    delete m_halControl;
+    if (m_halControl)
+        m_halManager->release(m_halControl);
 }
 
 QMediaControl *FMRadioService::requestControl(const char *name)
 {
     qDebug("Requesting control for %s...", name);
 
-    if (qstrcmp(name, QRadioTunerControl_iid) == 0)
+    if (qstrcmp(name, QRadioTunerControl_iid) == 0) {
+        if (!m_tunerControl)
+            m_tunerControl = new FMRadioTunerControl(this, halControl());
+        m_tunerRefs++;
         return m_tunerControl;
+    }
 
-    if (qstrcmp(name, QRadioDataControl_iid) == 0)
+    if (qstrcmp(name, QRadioDataControl_iid) == 0) {
+        if (!m_dataControl)
+            m_dataControl = new FMRadioDataControl(this, halControl());
+        m_dataRefs++;
         return m_dataControl;
+    }
+
+    if (qstrcmp(name, FMRadioExtensionControl_iid) == 0) {
+        if (!m_extensionControl)
+            m_extensionControl = new FMRadioExtensionControl(this, halControl());
+        m_extensionRefs++;
+        return m_extensionControl;
+    }
 
     return 0;
 }
 
 void FMRadioService::releaseControl(QMediaControl *control)
 {
+    if (!control)
+        return;
+
+    if (control == m_tunerControl) {
+        if (--m_tunerRefs == 0) {
+            delete m_tunerControl;
+            m_tunerControl = 0;
+        }
+    } else if (control == m_dataControl) {
+        if (--m_dataRefs == 0) {
+            delete m_dataControl;
+            m_dataControl = 0;
+        }
+    } else if (control == m_extensionControl) {
+        if (--m_extensionRefs == 0) {
+            delete m_extensionControl;
+            m_extensionControl = 0;
+        }
+    } else
+        return;
+
+    releaseHalControl();
+}
+
+FMRadioHalControl *FMRadioService::halControl()
+{
+    if (!m_halControl)
+        m_halControl = m_halManager->acquire();
+
+    return m_halControl;
+}
+
+void FMRadioService::releaseHalControl()
+{
+    if (!m_halControl || m_tunerControl || m_dataControl || m_extensionControl)
+        return;
+
+    m_halManager->release(m_halControl);
+    m_halControl = 0;
 }
 
 QT_END_NAMESPACE
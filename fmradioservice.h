@@ -29,22 +29,32 @@ class QRadioDataControl;
 
 class FMRadioTunerControl;
 class FMRadioDataControl;
+class FMRadioExtensionControl;
 class FMRadioHalControl;
+class FMRadioHalManager;
 
 class FMRadioService : public QMediaService
 {
     Q_OBJECT
 public:
-    FMRadioService(QObject *parent = 0);
+    FMRadioService(FMRadioHalManager *manager, QObject *parent = 0);
     ~FMRadioService();
 
     QMediaControl *requestControl(const char *name);
     void releaseControl(QMediaControl *control);
 
 private:
+    FMRadioHalControl *halControl();
+    void releaseHalControl();
+
+    FMRadioHalManager *m_halManager;
     FMRadioTunerControl *m_tunerControl;
     FMRadioDataControl *m_dataControl;
+    FMRadioExtensionControl *m_extensionControl;
     FMRadioHalControl *m_halControl;
+    int m_tunerRefs;
+    int m_dataRefs;
+    int m_extensionRefs;
 };
 
 QT_END_NAMESPACE
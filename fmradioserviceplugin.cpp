@@ -20,15 +20,29 @@
 
 #include "fmradioserviceplugin.h"
 #include "fmradioservice.h"
+#include "fmradiohalmanager.h"
 
 #include <QDebug>
 #include <QString>
 
+FMRadioServicePlugin::FMRadioServicePlugin(QObject *parent)
+    : QMediaServiceProviderPlugin(parent)
+    , m_halManager(new FMRadioHalManager)
+{
+}
+
+FMRadioServicePlugin::~FMRadioServicePlugin()
+{
+    // Services still alive release the HAL through the manager
+    qDeleteAll(findChildren<QMediaService*>(QString(), Qt::FindDirectChildrenOnly));
+    delete m_halManager;
+}
+
 QMediaService* FMRadioServicePlugin::create(const QString &key)
 {
     qDebug("Instantiating FM Radio service...");
     if (key == QLatin1String(Q_MEDIASERVICE_RADIO))
-        return new FMRadioService(this);
+        return new FMRadioService(m_halManager, this);
 
     qDebug("FM Radio service plugin: unsupported key: %s.", qPrintable(key));
     return NULL;
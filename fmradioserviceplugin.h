@@ -25,14 +25,22 @@
 
 QT_BEGIN_NAMESPACE
 
+class FMRadioHalManager;
+
 class FMRadioServicePlugin
     : public QMediaServiceProviderPlugin
 {
     Q_OBJECT
     Q_PLUGIN_METADATA(IID "org.qt-project.qt.mediaserviceproviderfactory/5.0" FILE "fmradio.json")
 public:
+    FMRadioServicePlugin(QObject *parent = 0);
+    ~FMRadioServicePlugin();
+
     QMediaService* create(QString const& key);
     void release(QMediaService* service);
+
+private:
+    FMRadioHalManager *m_halManager;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,375 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiostationcache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+
+#include <string.h>
+#include <sys/file.h>
+
+#define CACHE_MAGIC     0x46534331 // FSC1
+#define CACHE_VERSION   4
+
+#define TIMING_MAGIC    0x46544331 // FTC1
+#define TIMING_VERSION  1
+
+#define TIMING_MIN_SAMPLES  8
+#define TIMING_MAX_SAMPLES  256
+
+struct FMRadioStationCache::Header {
+    quint32 magic;
+    quint32 version;
+    qint32 count;
+    qint32 scanMode;
+    qint64 lastScan;
+};
+
+struct FMRadioTimingCache::Header {
+    quint32 magic;
+    quint32 version;
+    quint32 timingSamples[TimingCount];
+    quint32 timings[TimingCount][TimingBuckets];
+};
+
+static QString cachePath()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                   + QStringLiteral("/qtmultimedia-halradio");
+
+    return QDir().mkpath(path) ? path : QString();
+}
+
+static qint64 currentTime()
+{
+    return QDateTime::currentMSecsSinceEpoch() / 1000;
+}
+
+// Cut at an UTF-8 character boundary if str doesn't fit
+static void copyString(char *dest, size_t size, const QString &str)
+{
+    QByteArray utf8 = str.toUtf8();
+    size_t length = static_cast<size_t>(utf8.size());
+
+    if (length >= size) {
+        length = size - 1;
+        while (length > 0 && (static_cast<uchar>(utf8.at(length)) & 0xc0) == 0x80)
+            --length;
+    }
+
+    memcpy(dest, utf8.constData(), length);
+    memset(dest + length, 0, size - length);
+}
+
+FMRadioStationCache::FMRadioStationCache()
+    : m_header(0)
+    , m_stations(0)
+    , m_lockDepth(0)
+{
+}
+
+FMRadioStationCache::~FMRadioStationCache()
+{
+    close();
+}
+
+bool FMRadioStationCache::open(const QString &name)
+{
+    close();
+
+    QString path = cachePath();
+    if (path.isEmpty())
+        return false;
+
+    const qint64 size = sizeof(Header) + Capacity * sizeof(FMRadioStation);
+
+    m_file.setFileName(path + QStringLiteral("/stations-") + name);
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+
+    bool reset = m_file.size() != size;
+    if (reset && !m_file.resize(size)) {
+        m_file.close();
+        return false;
+    }
+
+    uchar *data = m_file.map(0, size);
+    if (!data) {
+        m_file.close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<Header*>(data);
+    m_stations = reinterpret_cast<FMRadioStation*>(data + sizeof(Header));
+
+    Locker locker(this);
+
+    if (reset
+        || m_header->magic != CACHE_MAGIC
+        || m_header->version != CACHE_VERSION
+        || m_header->count < 0
+        || m_header->count > Capacity) {
+        m_header->magic = CACHE_MAGIC;
+        m_header->version = CACHE_VERSION;
+        clear();
+    }
+
+    return true;
+}
+
+void FMRadioStationCache::close()
+{
+    if (!m_header)
+        return;
+
+    // Closing the file releases the lock as well
+    m_file.unmap(reinterpret_cast<uchar*>(m_header));
+    m_file.close();
+    m_header = 0;
+    m_stations = 0;
+    m_lockDepth = 0;
+}
+
+bool FMRadioStationCache::isOpen() const
+{
+    return m_header;
+}
+
+void FMRadioStationCache::lock()
+{
+    if (m_header && m_lockDepth++ == 0)
+        flock(m_file.handle(), LOCK_EX);
+}
+
+void FMRadioStationCache::unlock()
+{
+    if (m_header && m_lockDepth > 0 && --m_lockDepth == 0)
+        flock(m_file.handle(), LOCK_UN);
+}
+
+// Another process may have written anything there
+int FMRadioStationCache::count() const
+{
+    return m_header ? qBound(0, static_cast<int>(m_header->count), static_cast<int>(Capacity)) : 0;
+}
+
+const FMRadioStation &FMRadioStationCache::at(int index) const
+{
+    return m_stations[index];
+}
+
+int FMRadioStationCache::indexOf(unsigned frequency) const
+{
+    for (int i = 0; i < count(); ++i) {
+        if (m_stations[i].frequency == frequency)
+            return i;
+    }
+
+    return -1;
+}
+
+qint64 FMRadioStationCache::lastScan() const
+{
+    return m_header ? m_header->lastScan : 0;
+}
+
+int FMRadioStationCache::scanMode() const
+{
+    return m_header ? m_header->scanMode : 0;
+}
+
+void FMRadioStationCache::clear()
+{
+    if (!m_header)
+        return;
+
+    Locker locker(this);
+
+    m_header->count = 0;
+    m_header->scanMode = 0;
+    m_header->lastScan = 0;
+}
+
+void FMRadioStationCache::setScanComplete(int scanMode)
+{
+    if (!m_header)
+        return;
+
+    Locker locker(this);
+
+    m_header->scanMode = scanMode;
+    m_header->lastScan = currentTime();
+}
+
+bool FMRadioStationCache::update(unsigned frequency, const QString &stationId, const QString &stationName,
+                                 unsigned programType, int signalStrength, bool stereo, bool add)
+{
+    if (!m_header)
+        return false;
+
+    Locker locker(this);
+    int index = indexOf(frequency);
+
+    if (index < 0) {
+        index = count();
+        if (!add || index >= Capacity)
+            return false;
+        m_header->count = index + 1;
+        m_stations[index].frequency = frequency;
+    }
+
+    FMRadioStation &station = m_stations[index];
+    station.programType = programType;
+    station.signalStrength = signalStrength;
+    station.stereo = stereo;
+    station.lastSeen = currentTime();
+    copyString(station.stationId, sizeof(station.stationId), stationId);
+    copyString(station.stationName, sizeof(station.stationName), stationName);
+
+    return true;
+}
+
+void FMRadioStationCache::remove(unsigned frequency)
+{
+    Locker locker(this);
+    int index = indexOf(frequency);
+
+    if (index < 0)
+        return;
+
+    int last = count() - 1;
+    m_stations[index] = m_stations[last];
+    m_header->count = last;
+}
+
+QString FMRadioStationCache::stationId(const FMRadioStation &station)
+{
+    return QString::fromUtf8(station.stationId, qstrnlen(station.stationId, sizeof(station.stationId)));
+}
+
+QString FMRadioStationCache::stationName(const FMRadioStation &station)
+{
+    return QString::fromUtf8(station.stationName, qstrnlen(station.stationName, sizeof(station.stationName)));
+}
+
+FMRadioTimingCache::FMRadioTimingCache()
+    : m_header(0)
+{
+}
+
+FMRadioTimingCache::~FMRadioTimingCache()
+{
+    close();
+}
+
+bool FMRadioTimingCache::open(const QString &name)
+{
+    close();
+
+    QString path = cachePath();
+    if (path.isEmpty())
+        return false;
+
+    const qint64 size = sizeof(Header);
+
+    m_file.setFileName(path + QStringLiteral("/timings-") + name);
+    if (!m_file.open(QIODevice::ReadWrite))
+        return false;
+
+    bool reset = m_file.size() != size;
+    if (reset && !m_file.resize(size)) {
+        m_file.close();
+        return false;
+    }
+
+    uchar *data = m_file.map(0, size);
+    if (!data) {
+        m_file.close();
+        return false;
+    }
+
+    m_header = reinterpret_cast<Header*>(data);
+
+    if (reset
+        || m_header->magic != TIMING_MAGIC
+        || m_header->version != TIMING_VERSION) {
+        memset(m_header, 0, sizeof(Header));
+        m_header->magic = TIMING_MAGIC;
+        m_header->version = TIMING_VERSION;
+    }
+
+    return true;
+}
+
+void FMRadioTimingCache::close()
+{
+    if (!m_header)
+        return;
+
+    m_file.unmap(reinterpret_cast<uchar*>(m_header));
+    m_file.close();
+    m_header = 0;
+}
+
+bool FMRadioTimingCache::isOpen() const
+{
+    return m_header;
+}
+
+void FMRadioTimingCache::addTiming(Timing timing, int msecs)
+{
+    if (!m_header || msecs < 0)
+        return;
+
+    quint32 *buckets = m_header->timings[timing];
+    int bucket = qMin(msecs / TimingBucketMs, TimingBuckets - 1);
+
+    if (m_header->timingSamples[timing] >= TIMING_MAX_SAMPLES) {
+        quint32 samples = 0;
+        for (int i = 0; i < TimingBuckets; ++i) {
+            buckets[i] /= 2;
+            samples += buckets[i];
+        }
+        m_header->timingSamples[timing] = samples;
+    }
+
+    buckets[bucket]++;
+    m_header->timingSamples[timing]++;
+}
+
+int FMRadioTimingCache::timingPercentile(Timing timing, int percent) const
+{
+    if (!m_header || m_header->timingSamples[timing] < TIMING_MIN_SAMPLES)
+        return -1;
+
+    const quint32 *buckets = m_header->timings[timing];
+    quint32 target = (m_header->timingSamples[timing] * percent + 99) / 100;
+    quint32 samples = 0;
+
+    for (int i = 0; i < TimingBuckets; ++i) {
+        samples += buckets[i];
+        if (samples >= target)
+            return (i + 1) * TimingBucketMs;
+    }
+
+    return TimingBuckets * TimingBucketMs;
+}
@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOSTATIONCACHE_H
+#define __FMRADIOSTATIONCACHE_H
+
+#include <QFile>
+#include <QString>
+
+// On-disk layout of one cached station.
+struct FMRadioStation {
+    quint32 frequency;      // kHz
+    quint32 programType;    // raw RDS/RBDS PTY
+    qint32 signalStrength;  // 0 - 100, when last seen
+    quint32 stereo;
+    qint64 lastSeen;        // seconds since epoch
+    char stationId[8];
+    char stationName[24];
+};
+
+// Memory mapped station list of one band configuration. Stations are
+// updated in place in the mapping, so keeping the cache up to date
+// costs no file I/O from our side. The file may be open in more than
+// one process, so changes and walks over the stations hold a flock.
+class FMRadioStationCache
+{
+public:
+    static const int Capacity = 128;
+
+    // Holds the cache lock for its lifetime, may be nested.
+    class Locker
+    {
+    public:
+        explicit Locker(FMRadioStationCache *cache) : m_cache(cache) { m_cache->lock(); }
+        ~Locker() { m_cache->unlock(); }
+
+    private:
+        FMRadioStationCache *m_cache;
+    };
+
+    FMRadioStationCache();
+    ~FMRadioStationCache();
+
+    bool open(const QString &name);
+    void close();
+    bool isOpen() const;
+
+    void lock();
+    void unlock();
+
+    int count() const;
+    const FMRadioStation &at(int index) const;
+    int indexOf(unsigned frequency) const;
+
+    // Time and mode of last completed full scan, 0 if none.
+    qint64 lastScan() const;
+    int scanMode() const;
+
+    // Drop all stations when starting a new full scan, and mark the
+    // scan complete when it finishes.
+    void clear();
+    void setScanComplete(int scanMode);
+
+    // Update station, its reception and last seen time. New stations
+    // are added only if add is true. Returns false if station was not
+    // updated.
+    bool update(unsigned frequency, const QString &stationId, const QString &stationName,
+                unsigned programType, int signalStrength, bool stereo, bool add);
+    void remove(unsigned frequency);
+
+    static QString stationId(const FMRadioStation &station);
+    static QString stationName(const FMRadioStation &station);
+
+private:
+    struct Header;
+
+    QFile m_file;
+    Header *m_header;
+    FMRadioStation *m_stations;
+    int m_lockDepth;
+};
+
+// Memory mapped durations learned from one HAL. Timings describe the
+// device, not the band, so they are kept apart from the stations.
+class FMRadioTimingCache
+{
+public:
+    // Learned durations, kept as histograms of TimingBucketMs wide
+    // buckets. Older samples are halved away as new ones come in.
+    enum Timing {
+        SeekTime,       // scan start to RADIO_EVENT_TUNED
+        StationIdTime,  // tuned to PI received when searching
+        TimingCount
+    };
+    static const int TimingBuckets = 100;
+    static const int TimingBucketMs = 100;
+
+    FMRadioTimingCache();
+    ~FMRadioTimingCache();
+
+    bool open(const QString &name);
+    void close();
+    bool isOpen() const;
+
+    void addTiming(Timing timing, int msecs);
+    // Upper edge of the bucket in ms at or above given percent of
+    // samples, -1 if not enough samples yet.
+    int timingPercentile(Timing timing, int percent) const;
+
+private:
+    struct Header;
+
+    QFile m_file;
+    Header *m_header;
+};
+
+#endif
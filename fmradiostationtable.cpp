@@ -0,0 +1,165 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiostationtable.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+typedef FMRadioStationTable::Station Station;
+
+struct StationGroup {
+    int begin;
+    int end;
+    const Station *first;
+};
+
+}
+
+// Same station id together, strongest first
+static bool lessByStationId(const Station &a, const Station &b)
+{
+    int cmp = strncmp(a.stationId, b.stationId, sizeof(a.stationId));
+
+    if (cmp != 0)
+        return cmp < 0;
+
+    return a.signalStrength > b.signalStrength;
+}
+
+// Strongest station first, lower frequency first if equally strong
+static bool lessByStrength(const StationGroup &a, const StationGroup &b)
+{
+    if (a.first->signalStrength != b.first->signalStrength)
+        return a.first->signalStrength > b.first->signalStrength;
+
+    return a.first->frequency < b.first->frequency;
+}
+
+void FMRadioStationTable::clear()
+{
+    m_stations.clear();
+}
+
+int FMRadioStationTable::indexOf(unsigned frequency) const
+{
+    for (int i = 0; i < m_stations.size(); ++i) {
+        if (m_stations.at(i).frequency == frequency)
+            return i;
+    }
+
+    return -1;
+}
+
+void FMRadioStationTable::update(unsigned frequency, int signalStrength, bool stereo)
+{
+    int index = indexOf(frequency);
+
+    if (index < 0) {
+        Station station;
+        memset(&station, 0, sizeof(station));
+        station.frequency = frequency;
+        m_stations.append(station);
+        index = m_stations.size() - 1;
+    }
+
+    m_stations[index].signalStrength = signalStrength;
+    m_stations[index].stereo = stereo;
+}
+
+void FMRadioStationTable::setStationId(unsigned frequency, const QString &stationId)
+{
+    int index = indexOf(frequency);
+
+    if (index < 0)
+        return;
+
+    QByteArray id = stationId.toUtf8();
+    Station &station = m_stations[index];
+    size_t length = qMin(static_cast<size_t>(id.size()), sizeof(station.stationId) - 1);
+
+    memset(station.stationId, 0, sizeof(station.stationId));
+    memcpy(station.stationId, id.constData(), length);
+}
+
+void FMRadioStationTable::remove(unsigned frequency)
+{
+    int index = indexOf(frequency);
+
+    if (index >= 0)
+        m_stations.remove(index);
+}
+
+bool FMRadioStationTable::reception(unsigned frequency, int *signalStrength, bool *stereo) const
+{
+    int index = indexOf(frequency);
+
+    if (index < 0)
+        return false;
+
+    *signalStrength = m_stations.at(index).signalStrength;
+    *stereo = m_stations.at(index).stereo;
+
+    return true;
+}
+
+QVector<FMRadioStationTable::Station> FMRadioStationTable::ranked() const
+{
+    QVector<Station> stations(m_stations);
+    QVector<StationGroup> groups;
+
+    std::sort(stations.begin(), stations.end(), lessByStationId);
+
+    // Channels without station id can't be folded, so each of them
+    // forms a group of its own.
+    for (int i = 0; i < stations.size(); ++i) {
+        if (!groups.isEmpty()
+            && stations.at(i).stationId[0] != '\0'
+            && strncmp(stations.at(i).stationId, groups.last().first->stationId,
+                       sizeof(stations.at(i).stationId)) == 0) {
+            groups.last().end = i + 1;
+            continue;
+        }
+
+        StationGroup group = { i, i + 1, &stations.at(i) };
+        groups.append(group);
+    }
+
+    std::sort(groups.begin(), groups.end(), lessByStrength);
+
+    QVector<Station> result;
+    result.reserve(stations.size());
+
+    for (int i = 0; i < groups.size(); ++i) {
+        for (int j = groups.at(i).begin; j < groups.at(i).end; ++j) {
+            result.append(stations.at(j));
+            result.last().alternative = j != groups.at(i).begin;
+        }
+    }
+
+    return result;
+}
+
+QString FMRadioStationTable::stationId(const Station &station)
+{
+    return QString::fromUtf8(station.stationId, qstrnlen(station.stationId, sizeof(station.stationId)));
+}
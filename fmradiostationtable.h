@@ -0,0 +1,59 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOSTATIONTABLE_H
+#define __FMRADIOSTATIONTABLE_H
+
+#include <QString>
+#include <QVector>
+
+// Stations found during a search, kept in a flat array.
+class FMRadioStationTable
+{
+public:
+    struct Station {
+        unsigned frequency;     // kHz
+        int signalStrength;
+        bool stereo;
+        bool alternative;       // same station id as previous, weaker entry
+        char stationId[8];
+    };
+
+    void clear();
+    void update(unsigned frequency, int signalStrength, bool stereo);
+    void setStationId(unsigned frequency, const QString &stationId);
+    void remove(unsigned frequency);
+    // Returns false if frequency is not in the table.
+    bool reception(unsigned frequency, int *signalStrength, bool *stereo) const;
+
+    // Stations ordered by signal strength. Channels with same station id
+    // are folded together so that the strongest one comes first and the
+    // others follow it marked as alternative.
+    QVector<Station> ranked() const;
+
+    static QString stationId(const Station &station);
+
+private:
+    int indexOf(unsigned frequency) const;
+
+    QVector<Station> m_stations;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiostats.h"
+
+static const char *counterNames[FMRadioStats::CounterCount] = {
+    "tunes",
+    "seeks",
+    "seekTimeouts",
+    "stationIdTimeouts",
+    "hwFailures",
+    "commandFailures",
+    "metadataParsed",
+    "metadataRejected",
+    "metadataLarge",
+    "eventsDropped"
+};
+
+// Same order as radio_event_type_t
+static const char *eventNames[FMRadioStats::EventTypeCount] = {
+    "hwFailure",
+    "config",
+    "antenna",
+    "tuned",
+    "metadata",
+    "ta",
+    "afSwitch",
+    "ea",
+    "other"
+};
+
+FMRadioStats::FMRadioStats()
+{
+    reset();
+}
+
+void FMRadioStats::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled ? 1 : 0);
+}
+
+bool FMRadioStats::isEnabled() const
+{
+    return m_enabled.load();
+}
+
+void FMRadioStats::reset()
+{
+    for (int i = 0; i < CounterCount; ++i)
+        m_counters[i].store(0);
+
+    for (int i = 0; i < EventTypeCount; ++i)
+        m_events[i].store(0);
+
+    for (int span = 0; span < FMRadioTraceLog::SpanCount; ++span) {
+        for (int i = 0; i < LatencyBuckets; ++i)
+            m_latencies[span][i].store(0);
+    }
+}
+
+void FMRadioStats::addLatency(FMRadioTraceLog::Span span, qint64 latency)
+{
+    if (!m_enabled.load() || latency < 0)
+        return;
+
+    int bucket = 0;
+    while (latency > 0 && bucket < LatencyBuckets - 1) {
+        latency >>= 1;
+        ++bucket;
+    }
+
+    m_latencies[span][bucket].fetchAndAddRelaxed(1);
+}
+
+int FMRadioStats::value(Counter counter) const
+{
+    return m_counters[counter].load();
+}
+
+int FMRadioStats::eventValue(int type) const
+{
+    return m_events[type].load();
+}
+
+int FMRadioStats::latencyValue(FMRadioTraceLog::Span span, int bucket) const
+{
+    return m_latencies[span][bucket].load();
+}
+
+const char *FMRadioStats::counterName(Counter counter)
+{
+    return counterNames[counter];
+}
+
+const char *FMRadioStats::eventName(int type)
+{
+    return eventNames[type];
+}
@@ -0,0 +1,89 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOSTATS_H
+#define __FMRADIOSTATS_H
+
+#include "fmradiotracelog.h"
+
+#include <QAtomicInt>
+
+// Counters of HAL behaviour, for comparing HAL implementations across
+// devices. Nothing is counted until enabled, after which every count is
+// a relaxed atomic add, so counting from the radio event callback
+// thread needs no locking. Latencies are kept per trace span in log2
+// buckets: bucket n holds latencies of 2^(n-1) to 2^n-1 us, and the
+// last bucket everything longer.
+class FMRadioStats
+{
+public:
+    enum Counter {
+        Tunes,
+        Seeks,
+        SeekTimeouts,       // scan() not answered in time
+        StationIdTimeouts,  // SearchGetStationId candidate without PI in time
+        HwFailures,
+        CommandFailures,    // tuner calls returning an error
+        MetadataParsed,
+        MetadataRejected,   // not sane, or failed metadata_check
+        MetadataLarge,      // larger than a metadata buffer, copied to heap
+        EventsDropped,      // event queue or metadata buffers full
+        CounterCount
+    };
+
+    // RADIO_EVENT_HW_FAILURE to RADIO_EVENT_EA, others go to the last
+    static const int EventTypeCount = 9;
+    static const int LatencyBuckets = 26;
+
+    FMRadioStats();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void reset();
+
+    void count(Counter counter, int n = 1)
+    {
+        if (m_enabled.load())
+            m_counters[counter].fetchAndAddRelaxed(n);
+    }
+
+    void countEvent(int type)
+    {
+        if (m_enabled.load())
+            m_events[type >= 0 && type < EventTypeCount - 1 ? type : EventTypeCount - 1].fetchAndAddRelaxed(1);
+    }
+
+    void addLatency(FMRadioTraceLog::Span span, qint64 latency);
+
+    int value(Counter counter) const;
+    int eventValue(int type) const;
+    int latencyValue(FMRadioTraceLog::Span span, int bucket) const;
+
+    static const char *counterName(Counter counter);
+    static const char *eventName(int type);
+
+private:
+    QAtomicInt m_enabled;
+    QAtomicInt m_counters[CounterCount];
+    QAtomicInt m_events[EventTypeCount];
+    QAtomicInt m_latencies[FMRadioTraceLog::SpanCount][LatencyBuckets];
+};
+
+#endif
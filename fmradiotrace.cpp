@@ -0,0 +1,86 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiotrace.h"
+
+#include <string.h>
+
+FMRadioTraceRecorder::FMRadioTraceRecorder()
+{
+}
+
+FMRadioTraceRecorder::~FMRadioTraceRecorder()
+{
+    close();
+}
+
+bool FMRadioTraceRecorder::open(const QString &path, const radio_hal_properties_t &properties)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+        return false;
+
+    FMRadioTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FMRadioTraceHeader::Magic;
+    header.version = FMRadioTraceHeader::Version;
+    header.properties = properties;
+
+    if (m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        m_file.close();
+        return false;
+    }
+
+    m_clock.start();
+
+    return true;
+}
+
+bool FMRadioTraceRecorder::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+void FMRadioTraceRecorder::close()
+{
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+// Called in radio event callback thread
+void FMRadioTraceRecorder::record(const FMRadioEvent &event, const void *metadata, unsigned size)
+{
+    static const char padding[4] = { 0, 0, 0, 0 };
+
+    FMRadioTraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.time = m_clock.elapsed();
+    record.event = event;
+    record.event.metadata = -1;
+    record.metadataSize = metadata ? size : 0;
+
+    m_file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (record.metadataSize > 0) {
+        m_file.write(static_cast<const char*>(metadata), size);
+        m_file.write(padding, (4 - size % 4) % 4);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOTRACE_H
+#define __FMRADIOTRACE_H
+
+#include "fmradioeventqueue.h"
+
+#include <QFile>
+#include <QString>
+#include <QElapsedTimer>
+
+#include <android-config.h>
+#include <hardware/radio.h>
+
+// Radio event traces for reproducing HAL behaviour without the HAL.
+//
+// With HALRADIO_RECORD=<file> all events received from the HAL are
+// written to file. The fake HAL of the tests can replay the file, see
+// tests/common/fakeradiohal.h.
+//
+// The trace starts with a header containing HAL properties, followed by
+// one record per event with time in milliseconds from opening the file
+// and metadata blob, if any, padded to four bytes.
+struct FMRadioTraceHeader {
+    enum {
+        Magic = 0x52544648,  // "HFTR"
+        Version = 2
+    };
+
+    quint32 magic;
+    quint32 version;
+    radio_hal_properties_t properties;
+};
+
+struct FMRadioTraceRecord {
+    qint64 time;
+    FMRadioEvent event;
+    quint32 metadataSize;
+};
+
+class FMRadioTraceRecorder
+{
+public:
+    FMRadioTraceRecorder();
+    ~FMRadioTraceRecorder();
+
+    bool open(const QString &path, const radio_hal_properties_t &properties);
+    bool isOpen() const;
+    void close();
+
+    // Called in radio event callback thread
+    void record(const FMRadioEvent &event, const void *metadata, unsigned size);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+};
+
+#endif
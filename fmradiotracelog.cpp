@@ -0,0 +1,159 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiotracelog.h"
+#include "fmradiostats.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+#include <time.h>
+
+static const char *spanNames[FMRadioTraceLog::SpanCount] = {
+    "tune",
+    "seek",
+    "open_tuner",
+    "metadata",
+    "announcement",
+    "recovery"
+};
+
+FMRadioTraceLog::FMRadioTraceLog()
+    : m_count(0)
+    , m_stats(0)
+{
+    for (int i = 0; i < SpanCount; ++i)
+        m_pending[i] = -1;
+}
+
+qint64 FMRadioTraceLog::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void FMRadioTraceLog::start(Span span, qint64 time, int result)
+{
+    if (m_pending[span] >= 0)
+        append(span, m_pending[span], -1, 0, 0);
+
+    if (result != 0) {
+        append(span, time, 0, result, 0);
+        m_pending[span] = -1;
+    } else
+        m_pending[span] = time;
+}
+
+void FMRadioTraceLog::finish(Span span, unsigned channel, qint64 time)
+{
+    if (m_pending[span] < 0)
+        return;
+
+    qint64 latency = time - m_pending[span];
+    append(span, m_pending[span], static_cast<qint32>(qBound<qint64>(0, latency, 0x7fffffff)), 0, channel);
+    m_pending[span] = -1;
+
+    if (m_stats)
+        m_stats->addLatency(span, latency);
+}
+
+void FMRadioTraceLog::cancel(Span span)
+{
+    m_pending[span] = -1;
+}
+
+bool FMRadioTraceLog::isPending(Span span) const
+{
+    return m_pending[span] >= 0;
+}
+
+void FMRadioTraceLog::append(Span span, qint64 time, qint32 latency, int result, unsigned channel)
+{
+    Record &record = m_records[m_count % Capacity];
+
+    record.time = time;
+    record.latency = latency;
+    record.result = result;
+    record.channel = channel;
+    record.span = span;
+
+    ++m_count;
+}
+
+void FMRadioTraceLog::setStats(FMRadioStats *stats)
+{
+    m_stats = stats;
+}
+
+const char *FMRadioTraceLog::spanName(Span span)
+{
+    return spanNames[span];
+}
+
+bool FMRadioTraceLog::dump(const QString &path, const QString &header) const
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+
+    QTextStream out(&file);
+    QVector<qint32> latencies[SpanCount];
+    unsigned first = m_count > Capacity ? m_count - Capacity : 0;
+
+    out << header;
+    out << "# time_us span channel latency_us result\n";
+
+    for (unsigned i = first; i < m_count; ++i) {
+        const Record &record = m_records[i % Capacity];
+
+        out << record.time << ' ' << spanNames[record.span] << ' ' << record.channel << ' '
+            << record.latency << ' ' << record.result << '\n';
+
+        if (record.latency >= 0 && record.result == 0)
+            latencies[record.span].append(record.latency);
+    }
+
+    out << "# span count p50_us p90_us p99_us max_us\n";
+
+    for (int span = 0; span < SpanCount; ++span) {
+        QVector<qint32> &values = latencies[span];
+
+        if (values.isEmpty())
+            continue;
+
+        std::sort(values.begin(), values.end());
+
+        // nearest rank
+        int n = values.size();
+        out << "# " << spanNames[span] << ' ' << n
+            << ' ' << values.at((n * 50 + 99) / 100 - 1)
+            << ' ' << values.at((n * 90 + 99) / 100 - 1)
+            << ' ' << values.at((n * 99 + 99) / 100 - 1)
+            << ' ' << values.at(n - 1) << '\n';
+    }
+
+    out.flush();
+
+    return file.error() == QFile::NoError;
+}
@@ -0,0 +1,86 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOTRACELOG_H
+#define __FMRADIOTRACELOG_H
+
+#include <QString>
+#include <QtGlobal>
+
+class FMRadioStats;
+
+// Latency of HAL operations, kept in a fixed size ring of records in
+// the control thread. One record is written when an operation finishes
+// or fails, and the ring can be dumped to a text file together with
+// per operation percentiles.
+class FMRadioTraceLog
+{
+public:
+    enum Span {
+        Tune,       // tune() to RADIO_EVENT_TUNED
+        Seek,       // scan() to RADIO_EVENT_TUNED
+        OpenTuner,  // open_tuner() to first RADIO_EVENT_CONFIG
+        Metadata,   // RADIO_EVENT_METADATA to RDS signals
+        Announcement, // RADIO_EVENT_TA or _EA to announcement signal
+        Recovery,   // RADIO_EVENT_HW_FAILURE to tuner active again
+        SpanCount
+    };
+
+    static const unsigned Capacity = 512;
+
+    FMRadioTraceLog();
+
+    // Monotonic time in microseconds
+    static qint64 now();
+
+    // Operation started at time, HAL returned result. Failed operations
+    // are recorded right away, a still pending one is recorded as
+    // superseded.
+    void start(Span span, qint64 time, int result);
+    void finish(Span span, unsigned channel, qint64 time);
+    void cancel(Span span);
+    bool isPending(Span span) const;
+
+    // Header lines are written first, e.g. HAL implementor and product.
+    bool dump(const QString &path, const QString &header) const;
+
+    // Latencies of finished operations are also counted in stats.
+    void setStats(FMRadioStats *stats);
+
+    static const char *spanName(Span span);
+
+private:
+    struct Record {
+        qint64 time;        // start, us
+        qint32 latency;     // us, -1 if superseded
+        qint32 result;
+        quint32 channel;
+        quint32 span;
+    };
+
+    void append(Span span, qint64 time, qint32 latency, int result, unsigned channel);
+
+    Record m_records[Capacity];
+    unsigned m_count;   // total records written
+    qint64 m_pending[SpanCount];
+    FMRadioStats *m_stats;
+};
+
+#endif
@@ -51,6 +51,7 @@ FMRadioTunerControl::FMRadioTunerControl(QObject *parent, FMRadioHalControl *ctr
 
 FMRadioTunerControl::~FMRadioTunerControl()
 {
+    control->stop(this);
 }
 
 QRadioTuner::State FMRadioTunerControl::state() const
@@ -80,32 +81,12 @@ int FMRadioTunerControl::frequency() const
 
 int FMRadioTunerControl::frequencyStep(QRadioTuner::Band b) const
 {
-    int step = 0;
-
-    if (b == QRadioTuner::FM)
-        step = 100000; // 100kHz steps
-    else if (b == QRadioTuner::LW)
-        step = 1000; // 1kHz steps
-    else if (b == QRadioTuner::AM)
-        step = 1000; // 1kHz steps
-    else if (b == QRadioTuner::SW)
-        step = 500; // 500Hz steps
-
-    return step;
+    return control->frequencyStep(b);
 }
 
 QPair<int,int> FMRadioTunerControl::frequencyRange(QRadioTuner::Band b) const
 {
-    if (b == QRadioTuner::AM)
-        return qMakePair<int,int>(520000,1710000);
-    else if (b == QRadioTuner::FM)
-        return qMakePair<int,int>(87500000,108000000);
-    else if (b == QRadioTuner::SW)
-        return qMakePair<int,int>(1711111,30000000);
-    else if (b == QRadioTuner::LW)
-        return qMakePair<int,int>(148500,283500);
-
-    return qMakePair<int,int>(0,0);
+    return control->frequencyRange(b);
 }
 
 void FMRadioTunerControl::setFrequency(int frequency)
@@ -138,8 +119,9 @@ int FMRadioTunerControl::volume() const
     return control->volume();
 }
 
-void FMRadioTunerControl::setVolume(int)
+void FMRadioTunerControl::setVolume(int volume)
 {
+    control->setVolume(volume);
 }
 
 bool FMRadioTunerControl::isMuted() const
@@ -184,12 +166,12 @@ void FMRadioTunerControl::cancelSearch()
 
 void FMRadioTunerControl::start()
 {
-    control->start();
+    control->start(this);
 }
 
 void FMRadioTunerControl::stop()
 {
-    control->stop();
+    control->stop(this);
 }
 
 QRadioTuner::Error FMRadioTunerControl::error() const
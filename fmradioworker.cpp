@@ -0,0 +1,211 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradioworker.h"
+
+#include <QLoggingCategory>
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+Q_DECLARE_LOGGING_CATEGORY(log)
+
+FMRadioWorker::FMRadioWorker()
+    : QThread()
+    , m_busy(false)
+    , m_stop(false)
+    , m_tuner(0)
+{
+}
+
+FMRadioWorker::~FMRadioWorker()
+{
+    stop();
+}
+
+FMRadioCommand FMRadioWorker::command(int type, const struct radio_tuner *tuner)
+{
+    FMRadioCommand command;
+
+    memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.tuner = tuner;
+
+    return command;
+}
+
+void FMRadioWorker::post(const FMRadioCommand &command)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_commands.enqueue(command);
+    m_wait.wakeOne();
+}
+
+void FMRadioWorker::flush()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (isRunning() && (m_busy || !m_commands.isEmpty()))
+        m_idle.wait(&m_mutex);
+}
+
+// Commands posted before are still done
+void FMRadioWorker::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_wait.wakeOne();
+    }
+
+    wait();
+}
+
+const struct radio_tuner *FMRadioWorker::openTuner() const
+{
+    return m_tuner;
+}
+
+void FMRadioWorker::setScheduling()
+{
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    bool ok;
+
+    int nice = qgetenv("HALRADIO_WORKER_NICE").toInt(&ok);
+    if (ok && setpriority(PRIO_PROCESS, tid, nice) != 0)
+        qCWarning(log) << "Failed to set worker nice value" << nice;
+
+    QList<QByteArray> ranges = qgetenv("HALRADIO_WORKER_CPUS").split(',');
+    cpu_set_t cpus;
+    bool any = false;
+
+    CPU_ZERO(&cpus);
+    for (int i = 0; i < ranges.size(); ++i) {
+        QList<QByteArray> range = ranges.at(i).split('-');
+        bool firstOk, lastOk = true;
+        int first = range.at(0).trimmed().toInt(&firstOk);
+        int last = range.size() > 1 ? range.at(1).trimmed().toInt(&lastOk) : first;
+
+        if (!firstOk || !lastOk || range.size() > 2)
+            continue;
+
+        for (int cpu = qMax(first, 0); cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &cpus);
+            any = true;
+        }
+    }
+
+    if (any && sched_setaffinity(tid, sizeof(cpus), &cpus) != 0)
+        qCWarning(log) << "Failed to set worker CPU affinity";
+}
+
+void FMRadioWorker::run()
+{
+    setScheduling();
+
+    QMutexLocker locker(&m_mutex);
+
+    for (;;) {
+        while (m_commands.isEmpty() && !m_stop)
+            m_wait.wait(&m_mutex);
+
+        if (m_commands.isEmpty())
+            break;
+
+        FMRadioCommand command = m_commands.dequeue();
+        m_busy = true;
+        locker.unlock();
+
+        execute(command);
+
+        locker.relock();
+        m_busy = false;
+        m_idle.wakeAll();
+    }
+
+    m_idle.wakeAll();
+}
+
+void FMRadioWorker::execute(const FMRadioCommand &command)
+{
+    int ret = 0;
+
+    // Tuner may be closed before a command posted for it runs
+    if (command.type != FMRadioCommand::OpenTuner && !command.tuner) {
+        qCWarning(log) << "No tuner for command" << command.type;
+        if (command.type == FMRadioCommand::GetProgramInformation)
+            emit programInformation(-ENODEV, 0, 0);
+        else
+            emit commandFinished(command.type, -ENODEV, command.channel, command.time);
+        return;
+    }
+
+    switch (command.type) {
+        case FMRadioCommand::OpenTuner: {
+            const struct radio_tuner *tuner = 0;
+            ret = command.device->open_tuner(command.device, &command.config, command.audio,
+                                             command.callback, command.cookie, &tuner);
+            if (ret == 0)
+                m_tuner = tuner;
+            emit tunerOpened(ret, const_cast<struct radio_tuner*>(tuner), command.time);
+            return;
+        }
+
+        case FMRadioCommand::CloseTuner:
+            ret = command.device->close_tuner(command.device, command.tuner);
+            if (command.tuner == m_tuner)
+                m_tuner = 0;
+            break;
+
+        case FMRadioCommand::SetConfiguration:
+            ret = command.tuner->set_configuration(command.tuner, &command.config);
+            break;
+
+        case FMRadioCommand::Tune:
+        case FMRadioCommand::SearchTune:
+            ret = command.tuner->tune(command.tuner, command.channel, 0);
+            break;
+
+        case FMRadioCommand::Scan:
+            ret = command.tuner->scan(command.tuner, command.direction, false);
+            break;
+
+        case FMRadioCommand::Cancel:
+            ret = command.tuner->cancel(command.tuner);
+            break;
+
+        case FMRadioCommand::GetProgramInformation: {
+            radio_program_info_t info;
+            memset(&info, 0, sizeof(info));
+            ret = command.tuner->get_program_information(command.tuner, &info);
+            emit programInformation(ret, info.channel, info.signal_strength);
+            return;
+        }
+
+        default: return;
+    }
+
+    emit commandFinished(command.type, ret, command.channel, command.time);
+}
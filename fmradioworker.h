@@ -0,0 +1,103 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FMRADIOWORKER_H
+#define __FMRADIOWORKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+#include <android-config.h>
+#include <hardware/radio.h>
+
+// One tuner call to make in the worker thread.
+struct FMRadioCommand {
+    enum Type {
+        OpenTuner,
+        CloseTuner,
+        SetConfiguration,
+        Tune,
+        SearchTune,     // tune of SearchGetStationId candidate
+        Scan,
+        Cancel,
+        GetProgramInformation
+    };
+
+    int type;
+    qint64 time;        // FMRadioTraceLog::now() when posted
+    unsigned channel;
+    radio_direction_t direction;
+    struct radio_hw_device *device;
+    const struct radio_tuner *tuner;
+    radio_hal_band_config_t config;
+    bool audio;         // OpenTuner, tuner output is played
+    radio_callback_t callback;
+    void *cookie;
+};
+
+// Some HALs block for tens of milliseconds in tuner calls, so they are
+// made in this thread one at a time, in the order posted. Results come
+// back as signals, which are queued to the thread of the receiver.
+//
+// HALRADIO_WORKER_NICE sets nice value of the thread, and
+// HALRADIO_WORKER_CPUS the CPUs it may run on, e.g. "0-1,4".
+class FMRadioWorker : public QThread
+{
+    Q_OBJECT
+public:
+    FMRadioWorker();
+    ~FMRadioWorker();
+
+    static FMRadioCommand command(int type, const struct radio_tuner *tuner);
+
+    void post(const FMRadioCommand &command);
+
+    // Wait until all posted commands are done.
+    void flush();
+    void stop();
+
+    // Tuner opened last and not closed since, valid after flush().
+    const struct radio_tuner *openTuner() const;
+
+signals:
+    void commandFinished(int type, int result, unsigned channel, qint64 time);
+    void tunerOpened(int result, void *tuner, qint64 time);
+    void programInformation(int result, unsigned channel, unsigned signalStrength);
+
+protected:
+    void run();
+
+private:
+    void setScheduling();
+    void execute(const FMRadioCommand &command);
+
+    QMutex m_mutex;
+    QWaitCondition m_wait;
+    QWaitCondition m_idle;
+    QQueue<FMRadioCommand> m_commands;
+    bool m_busy;
+    bool m_stop;
+
+    const struct radio_tuner *m_tuner;
+};
+
+#endif
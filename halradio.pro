@@ -13,6 +13,7 @@ load(qt_plugin)
 
 qtCompileTest(radio_event_ea)
 qtCompileTest(ld_gold)
+qtCompileTest(lto)
 
 config_radio_event_ea {
     DEFINES += SUPPORT_RADIO_EVENT_EA
@@ -22,16 +23,75 @@ config_ld_gold {
     QMAKE_LFLAGS += -fuse-ld=gold
 }
 
+# Only the plugin entry points from Q_PLUGIN_METADATA are exported
+CONFIG += hide_symbols
+
+CONFIG(release, debug|release) {
+    QMAKE_CXXFLAGS += -ffunction-sections -fdata-sections
+    QMAKE_LFLAGS += -Wl,--gc-sections -Wl,-O1 -Wl,--as-needed
+
+    # Probed with the gold linker, so only together with it
+    config_ld_gold:config_lto {
+        CONFIG += ltcg
+    }
+
+    # Resolve all symbols at load time instead of lazily, compare with
+    # make budget before enabling.
+    halradio_bind_now {
+        QMAKE_LFLAGS += -Wl,-z,now
+    }
+}
+
+# make budget: plugin size, and load plus time until the radio tuner is
+# active, must stay within HALRADIO_SIZE_BUDGET bytes and
+# HALRADIO_LOAD_BUDGET_MS.
+isEmpty(HALRADIO_SIZE_BUDGET): HALRADIO_SIZE_BUDGET = 524288
+isEmpty(HALRADIO_LOAD_BUDGET_MS): HALRADIO_LOAD_BUDGET_MS = 300
+
+budget.depends = $(DESTDIR)$(TARGET)
+budget.commands = \
+    $(MKDIR) $$OUT_PWD/plugin-budget && \
+    $$QMAKE_QMAKE -o $$OUT_PWD/plugin-budget/Makefile $$PWD/tools/plugin-budget/plugin-budget.pro && \
+    $(MAKE) -C $$OUT_PWD/plugin-budget && \
+    $$OUT_PWD/plugin-budget/plugin-budget $(DESTDIR)$(TARGET) $$HALRADIO_SIZE_BUDGET $$HALRADIO_LOAD_BUDGET_MS
+QMAKE_EXTRA_TARGETS += budget
+
 SOURCES += fmradioserviceplugin.cpp \
            fmradiodatacontrol.cpp \
            fmradioservice.cpp \
            fmradiotunercontrol.cpp \
-           fmradiohalcontrol.cpp
+           fmradiohalcontrol.cpp \
+           fmradioeventqueue.cpp \
+           fmradiordstext.cpp \
+           fmradiordshistory.cpp \
+           fmradiostationcache.cpp \
+           fmradiohalmanager.cpp \
+           fmradiostationtable.cpp \
+           fmradioextensioncontrol.cpp \
+           fmradiotrace.cpp \
+           fmradiometadata.cpp \
+           fmradiotracelog.cpp \
+           fmradioworker.cpp \
+           fmradiobackgroundscan.cpp \
+           fmradiostats.cpp
 
 HEADERS += fmradioserviceplugin.h \
            fmradiodatacontrol.h \
            fmradioservice.h \
            fmradiotunercontrol.h \
-           fmradiohalcontrol.h
+           fmradiohalcontrol.h \
+           fmradioeventqueue.h \
+           fmradiordstext.h \
+           fmradiordshistory.h \
+           fmradiostationcache.h \
+           fmradiohalmanager.h \
+           fmradiostationtable.h \
+           fmradioextensioncontrol.h \
+           fmradiotrace.h \
+           fmradiometadata.h \
+           fmradiotracelog.h \
+           fmradioworker.h \
+           fmradiobackgroundscan.h \
+           fmradiostats.h
 
-QMAKE_LFLAGS += -lhybris-common
+LIBS += -lhybris-common
@@ -11,12 +11,14 @@ Group:      System/Libraries
 License:    LGPLv2.1
 URL:        https://github.com/mer-hybris/qt5-qtmultimedia-plugin-mediaservice-halradio
 Source0:    %{name}-%{version}.tar.bz2
+%bcond_with budget
 # Substitute with a UI app for your distribution:
 Recommends: jolla-mediaplayer-radio
 BuildRequires:  qt5-qtcore-devel
 BuildRequires:  qt5-qmake
 BuildRequires:  pkgconfig(Qt5Core)
 BuildRequires:  pkgconfig(Qt5Multimedia)
+BuildRequires:  pkgconfig(Qt5Test)
 BuildRequires:  pkgconfig(android-headers)
 BuildRequires:  pkgconfig(libhardware)
 BuildRequires:  libhybris-devel
@@ -34,6 +36,20 @@ Qt5 HAL FM Radio media service plugin
 
 %qtc_make %{?_smp_mflags}
 
+%check
+# Tests and benchmarks with a fake radio HAL
+mkdir -p tests-build
+cd tests-build
+%qtc_qmake5 ../tests
+%qtc_make %{?_smp_mflags}
+%qtc_make check
+cd ..
+
+# Plugin size and load time budget, needs a device to run on
+%if %{with budget}
+%qtc_make budget
+%endif
+
 %install
 rm -rf %{buildroot}
 %qmake5_install
@@ -0,0 +1,76 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "allocationcounter.h"
+
+#include <QAtomicInt>
+
+#include <stddef.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+namespace {
+
+QBasicAtomicInt counting = Q_BASIC_ATOMIC_INITIALIZER(0);
+QBasicAtomicInt allocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+inline void count()
+{
+    if (counting.load())
+        allocations.fetchAndAddRelaxed(1);
+}
+
+}
+
+extern "C" void *malloc(size_t size)
+{
+    count();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    ::count();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    count();
+    return __libc_realloc(ptr, size);
+}
+
+namespace AllocationCounter {
+
+void start()
+{
+    allocations.store(0);
+    counting.store(1);
+}
+
+int stop()
+{
+    counting.store(0);
+    return allocations.load();
+}
+
+}
@@ -0,0 +1,866 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fakeradiohal.h"
+#include "fmradiotrace.h"
+#include "fmradiotracelog.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <QDebug>
+
+#include <hardware/hardware.h>
+
+#include <errno.h>
+#include <string.h>
+
+namespace {
+
+struct Pending {
+    qint64 due;         // ms from tuner open
+    radio_hal_event_t event;
+    QByteArray metadata;
+};
+
+struct ReplayEvent {
+    qint64 time;
+    FMRadioEvent event;
+    QByteArray metadata;
+};
+
+struct Settings {
+    int tunerCount;
+    QVector<FakeRadioHal::Station> stations;
+    int tuneMs;
+    int scanMs;
+    int rdsMs;
+    bool replaying;
+    double speed;
+    radio_hal_properties_t replayProperties;
+    QVector<ReplayEvent> replay;
+};
+
+class FakeTuner;
+struct FakeDevice;
+
+// HAL functions get pointers to these, keep HAL structs first.
+struct DeviceHal {
+    radio_hw_device_t device;
+    FakeDevice *owner;
+};
+
+struct TunerHal {
+    struct radio_tuner tuner;
+    FakeTuner *owner;
+};
+
+struct FakeDevice {
+    DeviceHal hal;
+    radio_hal_properties_t properties;
+};
+
+QMutex settingsMutex;
+Settings *settings;
+QList<FakeTuner*> tuners;
+QAtomicInteger<qint64> lastCallback;
+QAtomicInt callbacks;
+
+Settings *currentSettings()
+{
+    if (!settings) {
+        settings = new Settings;
+        settings->tunerCount = 0;
+        settings->tuneMs = 0;
+        settings->scanMs = 0;
+        settings->rdsMs = 0;
+        settings->replaying = false;
+        settings->speed = 1.0;
+        memset(&settings->replayProperties, 0, sizeof(settings->replayProperties));
+    }
+
+    return settings;
+}
+
+class FakeTuner : public QThread
+{
+public:
+    FakeTuner(FakeDevice *device, const radio_hal_band_config_t &config, bool audio,
+              bool replay, radio_callback_t callback, void *cookie);
+    ~FakeTuner();
+
+    TunerHal hal;
+    FakeDevice *device;
+    bool audio;
+
+    void post(qint64 delay, const radio_hal_event_t &event, const QByteArray &metadata = QByteArray());
+
+    int setConfiguration(const radio_hal_band_config_t *config);
+    int getConfiguration(radio_hal_band_config_t *config);
+    int tune(unsigned channel);
+    int step(radio_direction_t direction);
+    int scan(radio_direction_t direction);
+    int cancel();
+    int programInformation(radio_program_info_t *info);
+
+protected:
+    void run();
+
+private:
+    void tuned(unsigned channel, qint64 delay);
+    void postLocked(qint64 delay, const radio_hal_event_t &event, const QByteArray &metadata);
+
+    radio_callback_t m_callback;
+    void *m_cookie;
+    QMutex m_mutex;
+    QWaitCondition m_wait;
+    QList<Pending> m_pending;
+    bool m_stop;
+    QElapsedTimer m_clock;
+    radio_hal_band_config_t m_config;
+    radio_program_info_t m_info;
+
+    // copied from settings when opened
+    QVector<FakeRadioHal::Station> m_stations;
+    int m_tuneMs;
+    int m_scanMs;
+    int m_rdsMs;
+    bool m_replaying;
+};
+
+// Called with settingsMutex held
+FakeTuner::FakeTuner(FakeDevice *device, const radio_hal_band_config_t &config, bool audio,
+                     bool replay, radio_callback_t callback, void *cookie)
+    : QThread()
+    , device(device)
+    , audio(audio)
+    , m_callback(callback)
+    , m_cookie(cookie)
+    , m_stop(false)
+    , m_config(config)
+{
+    memset(&hal.tuner, 0, sizeof(hal.tuner));
+    hal.owner = this;
+    memset(&m_info, 0, sizeof(m_info));
+    m_clock.start();
+
+    Settings *s = currentSettings();
+    m_stations = s->stations;
+    m_tuneMs = s->tuneMs;
+    m_scanMs = s->scanMs;
+    m_rdsMs = s->rdsMs;
+    m_replaying = replay;
+
+    radio_hal_event_t event;
+
+    if (!m_replaying) {
+        memset(&event, 0, sizeof(event));
+        event.type = RADIO_EVENT_CONFIG;
+        event.config = m_config;
+        post(0, event);
+        return;
+    }
+
+    for (int i = 0; i < s->replay.size(); ++i) {
+        const ReplayEvent &replay = s->replay.at(i);
+        qint64 time = s->speed > 0 ? static_cast<qint64>(replay.time / s->speed) : 0;
+
+        memset(&event, 0, sizeof(event));
+        event.type = static_cast<radio_event_type_t>(replay.event.type);
+
+        switch (replay.event.type) {
+            case RADIO_EVENT_CONFIG:
+                event.config = m_config;
+                event.config.type = static_cast<radio_band_t>(replay.event.band);
+                event.config.fm.stereo = replay.event.stereo;
+                break;
+
+            case RADIO_EVENT_TUNED:
+            case RADIO_EVENT_AF_SWITCH:
+                event.info.channel = replay.event.channel;
+                event.info.stereo = replay.event.stereo;
+                event.info.tuned = replay.event.tuned;
+                event.info.signal_strength = replay.event.signalStrength;
+                break;
+
+            case RADIO_EVENT_METADATA:
+                if (replay.metadata.isEmpty())
+                    continue;
+                break;
+
+            case RADIO_EVENT_HW_FAILURE:
+                break;
+
+            default:
+                event.on = replay.event.on;
+                break;
+        }
+
+        post(time, event, replay.metadata);
+    }
+}
+
+FakeTuner::~FakeTuner()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_wait.wakeAll();
+    }
+
+    wait();
+}
+
+void FakeTuner::post(qint64 delay, const radio_hal_event_t &event, const QByteArray &metadata)
+{
+    QMutexLocker locker(&m_mutex);
+    postLocked(delay, event, metadata);
+}
+
+void FakeTuner::postLocked(qint64 delay, const radio_hal_event_t &event, const QByteArray &metadata)
+{
+    Pending pending;
+    pending.due = m_clock.elapsed() + delay;
+    pending.event = event;
+    pending.metadata = metadata;
+
+    int i = m_pending.size();
+    while (i > 0 && m_pending.at(i - 1).due > pending.due)
+        --i;
+    m_pending.insert(i, pending);
+
+    m_wait.wakeAll();
+}
+
+void FakeTuner::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_stop) {
+        if (m_pending.isEmpty()) {
+            m_wait.wait(&m_mutex);
+            continue;
+        }
+
+        qint64 remaining = m_pending.first().due - m_clock.elapsed();
+        if (remaining > 0) {
+            m_wait.wait(&m_mutex, static_cast<unsigned long>(remaining));
+            continue;
+        }
+
+        Pending pending = m_pending.takeFirst();
+
+        // Trace has the tuner state, simulated tuner has it already
+        if (m_replaying && (pending.event.type == RADIO_EVENT_TUNED
+                            || pending.event.type == RADIO_EVENT_AF_SWITCH))
+            m_info = pending.event.info;
+
+        locker.unlock();
+
+        if (pending.event.type == RADIO_EVENT_METADATA)
+            pending.event.metadata = reinterpret_cast<radio_metadata_t*>(pending.metadata.data());
+
+        lastCallback.store(FMRadioTraceLog::now());
+        m_callback(&pending.event, m_cookie);
+        callbacks.ref();
+
+        locker.relock();
+    }
+}
+
+int FakeTuner::setConfiguration(const radio_hal_band_config_t *config)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_config = *config;
+    if (m_replaying)
+        return 0;
+
+    radio_hal_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = RADIO_EVENT_CONFIG;
+    event.config = m_config;
+    postLocked(0, event, QByteArray());
+
+    return 0;
+}
+
+int FakeTuner::getConfiguration(radio_hal_band_config_t *config)
+{
+    QMutexLocker locker(&m_mutex);
+    *config = m_config;
+    return 0;
+}
+
+// Called with m_mutex held
+void FakeTuner::tuned(unsigned channel, qint64 delay)
+{
+    const FakeRadioHal::Station *station = 0;
+
+    for (int i = 0; i < m_stations.size(); ++i) {
+        if (m_stations.at(i).frequency == channel) {
+            station = &m_stations.at(i);
+            break;
+        }
+    }
+
+    m_info.channel = channel;
+    m_info.tuned = station;
+    m_info.stereo = station && station->stereo;
+    m_info.signal_strength = station ? station->signalStrength : 0;
+
+    radio_hal_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = RADIO_EVENT_TUNED;
+    event.info = m_info;
+    postLocked(delay, event, QByteArray());
+
+    if (!station || station->stationId.isEmpty() || m_config.fm.rds == RADIO_RDS_NONE)
+        return;
+
+    QVector<FakeRadioHal::Text> texts;
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PI, station->stationId));
+    if (!station->stationName.isEmpty())
+        texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PS, station->stationName));
+
+    memset(&event, 0, sizeof(event));
+    event.type = RADIO_EVENT_METADATA;
+    postLocked(delay + m_rdsMs, event, FakeRadioHal::metadata(texts));
+}
+
+int FakeTuner::tune(unsigned channel)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (channel < m_config.lower_limit || channel > m_config.upper_limit)
+        return -EINVAL;
+
+    if (!m_replaying)
+        tuned(channel, m_tuneMs);
+
+    return 0;
+}
+
+int FakeTuner::step(radio_direction_t direction)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_replaying)
+        return 0;
+
+    unsigned spacing = m_config.num_spacings > 0 ? m_config.spacings[0] : 100;
+    unsigned channel = m_info.channel;
+
+    if (direction == RADIO_DIRECTION_UP)
+        channel = channel + spacing > m_config.upper_limit ? m_config.lower_limit : channel + spacing;
+    else
+        channel = channel < m_config.lower_limit + spacing ? m_config.upper_limit : channel - spacing;
+
+    tuned(channel, m_tuneMs);
+
+    return 0;
+}
+
+// Next station in the direction, wrapping around at the band edges
+int FakeTuner::scan(radio_direction_t direction)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_replaying)
+        return 0;
+
+    const FakeRadioHal::Station *found = 0;
+    const FakeRadioHal::Station *wrapped = 0;
+
+    for (int i = 0; i < m_stations.size(); ++i) {
+        const FakeRadioHal::Station &station = m_stations.at(i);
+
+        if (station.frequency < m_config.lower_limit || station.frequency > m_config.upper_limit)
+            continue;
+
+        if (direction == RADIO_DIRECTION_UP) {
+            if (station.frequency > m_info.channel && (!found || station.frequency < found->frequency))
+                found = &station;
+            if (!wrapped || station.frequency < wrapped->frequency)
+                wrapped = &station;
+        } else {
+            if (station.frequency < m_info.channel && (!found || station.frequency > found->frequency))
+                found = &station;
+            if (!wrapped || station.frequency > wrapped->frequency)
+                wrapped = &station;
+        }
+    }
+
+    if (!found)
+        found = wrapped;
+
+    if (found) {
+        tuned(found->frequency, m_scanMs);
+    } else {
+        radio_hal_event_t event;
+        memset(&event, 0, sizeof(event));
+        event.type = RADIO_EVENT_TUNED;
+        event.info = m_info;
+        event.info.tuned = false;
+        postLocked(m_scanMs, event, QByteArray());
+    }
+
+    return 0;
+}
+
+// Drops answers not sent yet
+int FakeTuner::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_replaying)
+        return 0;
+
+    for (int i = m_pending.size() - 1; i >= 0; --i) {
+        int type = m_pending.at(i).event.type;
+        if (type == RADIO_EVENT_TUNED || type == RADIO_EVENT_METADATA)
+            m_pending.removeAt(i);
+    }
+
+    return 0;
+}
+
+int FakeTuner::programInformation(radio_program_info_t *info)
+{
+    QMutexLocker locker(&m_mutex);
+    radio_metadata_t *metadata = info->metadata;
+    *info = m_info;
+    info->metadata = metadata;
+    return 0;
+}
+
+FakeTuner *fakeTuner(const struct radio_tuner *tuner)
+{
+    return reinterpret_cast<const TunerHal*>(tuner)->owner;
+}
+
+FakeDevice *fakeDevice(const struct radio_hw_device *dev)
+{
+    return reinterpret_cast<const DeviceHal*>(dev)->owner;
+}
+
+int fakeSetConfiguration(const struct radio_tuner *tuner, const radio_hal_band_config_t *config)
+{
+    return fakeTuner(tuner)->setConfiguration(config);
+}
+
+int fakeGetConfiguration(const struct radio_tuner *tuner, radio_hal_band_config_t *config)
+{
+    return fakeTuner(tuner)->getConfiguration(config);
+}
+
+int fakeScan(const struct radio_tuner *tuner, radio_direction_t direction, bool)
+{
+    return fakeTuner(tuner)->scan(direction);
+}
+
+int fakeStep(const struct radio_tuner *tuner, radio_direction_t direction, bool)
+{
+    return fakeTuner(tuner)->step(direction);
+}
+
+int fakeTune(const struct radio_tuner *tuner, unsigned int channel, unsigned int)
+{
+    return fakeTuner(tuner)->tune(channel);
+}
+
+int fakeCancel(const struct radio_tuner *tuner)
+{
+    return fakeTuner(tuner)->cancel();
+}
+
+int fakeGetProgramInformation(const struct radio_tuner *tuner, radio_program_info_t *info)
+{
+    return fakeTuner(tuner)->programInformation(info);
+}
+
+int fakeGetProperties(const struct radio_hw_device *dev, radio_hal_properties_t *properties)
+{
+    *properties = fakeDevice(dev)->properties;
+    return 0;
+}
+
+int fakeOpenTuner(const struct radio_hw_device *dev, const radio_hal_band_config_t *config,
+                  bool audio, radio_callback_t callback, void *cookie,
+                  const struct radio_tuner **tuner)
+{
+    FakeDevice *device = fakeDevice(dev);
+    QMutexLocker locker(&settingsMutex);
+    int count = 0;
+
+    for (int i = 0; i < tuners.size(); ++i) {
+        if (tuners.at(i)->device == device)
+            ++count;
+    }
+
+    if (count >= static_cast<int>(device->properties.num_tuners))
+        return -EBUSY;
+
+    // Trace has the events of one tuner, others are simulated
+    FakeTuner *fake = new FakeTuner(device, *config, audio, currentSettings()->replaying && count == 0,
+                                    callback, cookie);
+    struct radio_tuner *t = &fake->hal.tuner;
+    t->set_configuration = fakeSetConfiguration;
+    t->get_configuration = fakeGetConfiguration;
+    t->scan = fakeScan;
+    t->step = fakeStep;
+    t->tune = fakeTune;
+    t->cancel = fakeCancel;
+    t->get_program_information = fakeGetProgramInformation;
+
+    tuners.append(fake);
+    fake->start();
+    *tuner = t;
+
+    return 0;
+}
+
+int fakeCloseTuner(const struct radio_hw_device *, const struct radio_tuner *tuner)
+{
+    FakeTuner *fake = fakeTuner(tuner);
+
+    {
+        QMutexLocker locker(&settingsMutex);
+        if (!tuners.removeOne(fake))
+            return -EINVAL;
+    }
+
+    delete fake;
+
+    return 0;
+}
+
+int fakeClose(struct hw_device_t *dev)
+{
+    FakeDevice *device = fakeDevice(reinterpret_cast<struct radio_hw_device*>(dev));
+    QList<FakeTuner*> closed;
+
+    {
+        QMutexLocker locker(&settingsMutex);
+        for (int i = tuners.size() - 1; i >= 0; --i) {
+            if (tuners.at(i)->device == device)
+                closed.append(tuners.takeAt(i));
+        }
+    }
+
+    qDeleteAll(closed);
+    delete device;
+
+    return 0;
+}
+
+void simulatedProperties(radio_hal_properties_t *properties, int tunerCount)
+{
+    memset(properties, 0, sizeof(*properties));
+    properties->class_id = RADIO_CLASS_AM_FM;
+    strncpy(properties->implementor, "halradio-tests", RADIO_STRING_LEN_MAX - 1);
+    strncpy(properties->product, "fake-tuner", RADIO_STRING_LEN_MAX - 1);
+    strncpy(properties->version, "1.0", RADIO_STRING_LEN_MAX - 1);
+    strncpy(properties->serial, "0", RADIO_STRING_LEN_MAX - 1);
+    properties->num_tuners = tunerCount;
+    properties->num_audio_sources = 1;
+    properties->supports_capture = false;
+    properties->num_bands = 1;
+
+    radio_hal_band_config_t &band = properties->bands[0];
+    band.type = RADIO_BAND_FM;
+    band.antenna_connected = true;
+    band.lower_limit = 87500;
+    band.upper_limit = 108000;
+    band.num_spacings = 1;
+    band.spacings[0] = 100;
+    band.fm.deemphasis = RADIO_DEEMPHASIS_50 | RADIO_DEEMPHASIS_75;
+    band.fm.stereo = true;
+    band.fm.rds = RADIO_RDS_WORLD | RADIO_RDS_US;
+    band.fm.ta = true;
+    band.fm.af = true;
+}
+
+int fakeOpen(const struct hw_module_t *module, const char *name, struct hw_device_t **dev)
+{
+    if (strcmp(name, RADIO_HARDWARE_DEVICE) != 0)
+        return -EINVAL;
+
+    FakeDevice *device = new FakeDevice;
+
+    {
+        QMutexLocker locker(&settingsMutex);
+        Settings *s = currentSettings();
+
+        if (s->replaying) {
+            device->properties = s->replayProperties;
+            if (s->tunerCount > 0)
+                device->properties.num_tuners = s->tunerCount;
+        } else {
+            simulatedProperties(&device->properties, s->tunerCount > 0 ? s->tunerCount : 1);
+        }
+    }
+
+    radio_hw_device_t *hw = &device->hal.device;
+    memset(hw, 0, sizeof(*hw));
+    hw->common.tag = HARDWARE_DEVICE_TAG;
+    hw->common.version = RADIO_DEVICE_API_VERSION_1_0;
+    hw->common.module = const_cast<struct hw_module_t*>(module);
+    hw->common.close = fakeClose;
+    hw->get_properties = fakeGetProperties;
+    hw->open_tuner = fakeOpenTuner;
+    hw->close_tuner = fakeCloseTuner;
+    device->hal.owner = device;
+
+    *dev = &hw->common;
+
+    return 0;
+}
+
+struct hw_module_methods_t fakeMethods;
+struct hw_module_t fakeModule;
+
+} // namespace
+
+namespace FakeRadioHal {
+
+void reset()
+{
+    QMutexLocker locker(&settingsMutex);
+    Settings *s = currentSettings();
+
+    s->tunerCount = 0;
+    s->stations.clear();
+    s->tuneMs = 0;
+    s->scanMs = 0;
+    s->rdsMs = 0;
+    s->replaying = false;
+    s->speed = 1.0;
+    s->replay.clear();
+}
+
+void setTunerCount(int count)
+{
+    QMutexLocker locker(&settingsMutex);
+    currentSettings()->tunerCount = count;
+}
+
+void setStations(const QVector<Station> &stations)
+{
+    QMutexLocker locker(&settingsMutex);
+    currentSettings()->stations = stations;
+}
+
+void setDelays(int tuneMs, int scanMs, int rdsMs)
+{
+    QMutexLocker locker(&settingsMutex);
+    Settings *s = currentSettings();
+
+    s->tuneMs = tuneMs;
+    s->scanMs = scanMs;
+    s->rdsMs = rdsMs;
+}
+
+int setReplay(const QString &path, double speed)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open trace" << path << ":" << file.errorString();
+        return -1;
+    }
+
+    FMRadioTraceHeader header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)
+        || header.magic != FMRadioTraceHeader::Magic
+        || header.version != FMRadioTraceHeader::Version) {
+        qWarning() << "Invalid trace" << path;
+        return -1;
+    }
+
+    QVector<ReplayEvent> events;
+    FMRadioTraceRecord record;
+
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record)) == sizeof(record)) {
+        ReplayEvent replay;
+        replay.time = record.time;
+        replay.event = record.event;
+
+        if (record.metadataSize > 0) {
+            replay.metadata = file.read((record.metadataSize + 3) & ~3u);
+            if (replay.metadata.size() < static_cast<int>(record.metadataSize)) {
+                qWarning() << "Truncated trace" << path;
+                break;
+            }
+            replay.metadata.truncate(record.metadataSize);
+        }
+
+        events.append(replay);
+    }
+
+    QMutexLocker locker(&settingsMutex);
+    Settings *s = currentSettings();
+
+    s->replaying = true;
+    s->speed = speed;
+    s->replayProperties = header.properties;
+    s->replay = events;
+
+    return events.size();
+}
+
+void sendEvent(const radio_hal_event_t &event, int delayMs)
+{
+    QMutexLocker locker(&settingsMutex);
+
+    for (int i = 0; i < tuners.size(); ++i) {
+        if (tuners.at(i)->audio) {
+            tuners.at(i)->post(delayMs, event);
+            return;
+        }
+    }
+}
+
+void sendMetadata(const QVector<Text> &texts, int delayMs)
+{
+    QMutexLocker locker(&settingsMutex);
+    radio_hal_event_t event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = RADIO_EVENT_METADATA;
+
+    for (int i = 0; i < tuners.size(); ++i) {
+        if (tuners.at(i)->audio) {
+            tuners.at(i)->post(delayMs, event, metadata(texts));
+            return;
+        }
+    }
+}
+
+qint64 lastCallbackTime()
+{
+    return lastCallback.load();
+}
+
+int callbackCount()
+{
+    return callbacks.load();
+}
+
+int openTunerCount()
+{
+    QMutexLocker locker(&settingsMutex);
+    return tuners.size();
+}
+
+int audioTunerCount()
+{
+    QMutexLocker locker(&settingsMutex);
+    int count = 0;
+
+    for (int i = 0; i < tuners.size(); ++i) {
+        if (tuners.at(i)->audio)
+            ++count;
+    }
+
+    return count;
+}
+
+// Header of channel, sub channel, size and count in ints, entries of
+// key, type, size and data padded to ints, and entry offsets stored
+// backwards from the end.
+QByteArray metadata(const QVector<Text> &texts)
+{
+    QVector<unsigned int> data(4, 0);
+    QVector<unsigned int> offsets;
+
+    for (int i = 0; i < texts.size(); ++i) {
+        QByteArray text = texts.at(i).second;
+        text.append('\0');
+
+        offsets.append(data.size());
+        data.append(texts.at(i).first);
+        data.append(RADIO_METADATA_TYPE_TEXT);
+        data.append(text.size());
+
+        int start = data.size();
+        data.resize(start + (text.size() + 3) / 4);
+        memset(data.data() + start, 0, (data.size() - start) * sizeof(unsigned int));
+        memcpy(data.data() + start, text.constData(), text.size());
+    }
+
+    for (int i = offsets.size() - 1; i >= 0; --i)
+        data.append(offsets.at(i));
+
+    data[2] = data.size();
+    data[3] = texts.size();
+
+    return QByteArray(reinterpret_cast<const char*>(data.constData()), data.size() * sizeof(unsigned int));
+}
+
+} // namespace FakeRadioHal
+
+// In place of libhardware
+extern "C" int hw_get_module_by_class(const char *class_id, const char *,
+                                      const struct hw_module_t **module)
+{
+    if (strcmp(class_id, RADIO_HARDWARE_MODULE_ID) != 0)
+        return -ENOENT;
+
+    if (!fakeModule.methods) {
+        fakeMethods.open = fakeOpen;
+        fakeModule.tag = HARDWARE_MODULE_TAG;
+        fakeModule.module_api_version = RADIO_MODULE_API_VERSION_1_0;
+        fakeModule.hal_api_version = HARDWARE_HAL_API_VERSION;
+        fakeModule.id = RADIO_HARDWARE_MODULE_ID;
+        fakeModule.name = "halradio test radio HAL";
+        fakeModule.author = "halradio";
+        fakeModule.methods = &fakeMethods;
+    }
+
+    *module = &fakeModule;
+
+    return 0;
+}
+
+extern "C" int hw_get_module(const char *id, const struct hw_module_t **module)
+{
+    return hw_get_module_by_class(id, 0, module);
+}
+
+// In place of libhybris-common, libradio_metadata is never found
+extern "C" void *android_dlopen(const char *, int)
+{
+    return 0;
+}
+
+extern "C" void *android_dlsym(void *, const char *)
+{
+    return 0;
+}
+
+extern "C" int android_dlclose(void *)
+{
+    return 0;
+}
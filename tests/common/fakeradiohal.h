@@ -0,0 +1,86 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef __FAKERADIOHAL_H
+#define __FAKERADIOHAL_H
+
+#include <QByteArray>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include <android-config.h>
+#include <hardware/radio.h>
+#include <system/radio_metadata.h>
+
+// Fake radio HAL for tests and benchmarks. Test binaries are linked with
+// the plugin sources and this file, which provides hw_get_module_by_class()
+// and the libhybris android_dl*() functions in place of libhardware and
+// libhybris-common, so nothing of it ends up in the plugin.
+//
+// Every open tuner has its own callback thread. A tuner simulates a
+// band with the stations set with setStations(), answering tune() and
+// scan() with RADIO_EVENT_TUNED after the configured delays and then
+// sending RDS PI and PS of the station. When a trace recorded with
+// HALRADIO_RECORD is set with setReplay(), the first tuner opened
+// replays it instead and ignores the tuner calls, and other tuners are
+// simulated.
+//
+// The device has one tuner, or as many as the trace was recorded with,
+// unless set with setTunerCount().
+namespace FakeRadioHal {
+
+struct Station {
+    unsigned frequency;     // kHz
+    unsigned signalStrength;
+    bool stereo;
+    QByteArray stationId;   // RDS PI, no RDS if empty
+    QByteArray stationName;
+};
+
+typedef QPair<radio_metadata_key_t, QByteArray> Text;
+
+// Settings used by tuners opened after the call.
+void reset();
+void setTunerCount(int count);
+void setStations(const QVector<Station> &stations);
+void setDelays(int tuneMs, int scanMs, int rdsMs);
+// Returns number of events in the trace, or -1 if it can't be read.
+int setReplay(const QString &path, double speed);
+
+// Event from the callback thread of the tuner routed to audio, after
+// delayMs. Queued right away, so nothing is allocated when sent.
+void sendEvent(const radio_hal_event_t &event, int delayMs = 0);
+void sendMetadata(const QVector<Text> &texts, int delayMs = 0);
+
+// FMRadioTraceLog::now() right before the last callback was called.
+qint64 lastCallbackTime();
+int callbackCount();
+
+int openTunerCount();
+// Open tuners with output routed to audio
+int audioTunerCount();
+
+// radio_metadata_t layout libradio_metadata uses, with text entries.
+QByteArray metadata(const QVector<Text> &texts);
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+# Plugin sources built into a test binary, with the fake radio HAL in
+# place of libhardware and libhybris-common.
+
+HALRADIO_SRC = $$PWD/../..
+
+QT += multimedia-private testlib
+CONFIG += link_pkgconfig testcase
+CONFIG -= app_bundle
+
+PKGCONFIG += android-headers
+
+INCLUDEPATH += $$HALRADIO_SRC $$PWD
+
+SOURCES += $$HALRADIO_SRC/fmradiohalcontrol.cpp \
+           $$HALRADIO_SRC/fmradioeventqueue.cpp \
+           $$HALRADIO_SRC/fmradiordstext.cpp \
+           $$HALRADIO_SRC/fmradiordshistory.cpp \
+           $$HALRADIO_SRC/fmradiostationcache.cpp \
+           $$HALRADIO_SRC/fmradiostationtable.cpp \
+           $$HALRADIO_SRC/fmradiotrace.cpp \
+           $$HALRADIO_SRC/fmradiometadata.cpp \
+           $$HALRADIO_SRC/fmradiotracelog.cpp \
+           $$HALRADIO_SRC/fmradioworker.cpp \
+           $$HALRADIO_SRC/fmradiobackgroundscan.cpp \
+           $$HALRADIO_SRC/fmradiostats.cpp \
+           $$PWD/fakeradiohal.cpp \
+           $$PWD/allocationcounter.cpp
+
+HEADERS += $$HALRADIO_SRC/fmradiohalcontrol.h \
+           $$HALRADIO_SRC/fmradioworker.h \
+           $$HALRADIO_SRC/fmradiobackgroundscan.h \
+           $$PWD/fakeradiohal.h \
+           $$PWD/allocationcounter.h
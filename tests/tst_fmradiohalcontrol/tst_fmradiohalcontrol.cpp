@@ -0,0 +1,532 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiohalcontrol.h"
+#include "fmradioeventqueue.h"
+#include "fmradiotracelog.h"
+#include "fakeradiohal.h"
+#include "allocationcounter.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QtTest>
+
+#include <algorithm>
+#include <string.h>
+
+// p99 of RADIO_EVENT callback to control signal, for queued events and
+// announcements, can be overridden with HALRADIO_TEST_LATENCY_MS on
+// slow builders
+#define EVENT_LATENCY_BOUND_MS  20
+
+#define RDS_EVENTS              100
+
+class tst_FMRadioHalControl : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void received();
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void eventLatency();
+    void announcementLatency();
+    void searchAllStations_data();
+    void searchAllStations();
+    void cachedStations();
+    void timingCache();
+    void rdsAllocations_data();
+    void rdsAllocations();
+    void largeMetadata();
+    void mute();
+    void idle();
+    void backgroundScan();
+    void rdsHistoryClients();
+    void replay();
+
+private:
+    bool startControl();
+    bool searchAll(QRadioTuner::SearchMode mode);
+    qreal latencyBound() const;
+    void report(const char *name, QVector<qint64> latencies);
+
+    FMRadioHalControl *m_control;
+    qint64 m_received;
+};
+
+static QVector<FakeRadioHal::Station> testStations()
+{
+    static const struct {
+        unsigned frequency;
+        unsigned signalStrength;
+        bool stereo;
+        const char *stationId;
+        const char *stationName;
+    } stations[] = {
+        {  88100, 70, true,  "6201", "YLE 1" },
+        {  91900, 40, false, "",     ""      },
+        {  94000, 85, true,  "6202", "YLEX"  },
+        {  98500, 55, true,  "6203", "NOVA"  },
+        { 101100, 30, false, "",     ""      },
+        { 103700, 90, true,  "6204", "SUOMI" },
+        { 106200, 60, true,  "6205", "RADIO" },
+    };
+
+    QVector<FakeRadioHal::Station> result;
+    for (unsigned i = 0; i < sizeof(stations) / sizeof(stations[0]); ++i) {
+        FakeRadioHal::Station station;
+        station.frequency = stations[i].frequency;
+        station.signalStrength = stations[i].signalStrength;
+        station.stereo = stations[i].stereo;
+        station.stationId = stations[i].stationId;
+        station.stationName = stations[i].stationName;
+        result.append(station);
+    }
+
+    return result;
+}
+
+static radio_hal_event_t onOffEvent(radio_event_type_t type, bool on)
+{
+    radio_hal_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.on = on;
+    return event;
+}
+
+static radio_hal_event_t antennaEvent(bool connected)
+{
+    return onOffEvent(RADIO_EVENT_ANTENNA, connected);
+}
+
+void tst_FMRadioHalControl::received()
+{
+    m_received = FMRadioTraceLog::now();
+}
+
+void tst_FMRadioHalControl::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    qRegisterMetaType<QRadioTuner::State>();
+    qRegisterMetaType<QRadioTuner::Error>();
+}
+
+// Every test starts without cached stations or learned timings
+void tst_FMRadioHalControl::init()
+{
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).removeRecursively();
+    FakeRadioHal::reset();
+    FakeRadioHal::setStations(testStations());
+    m_control = 0;
+    m_received = 0;
+}
+
+void tst_FMRadioHalControl::cleanup()
+{
+    if (m_control) {
+        m_control->stop(this);
+        delete m_control;
+        m_control = 0;
+    }
+
+    QCOMPARE(FakeRadioHal::openTunerCount(), 0);
+}
+
+bool tst_FMRadioHalControl::startControl()
+{
+    m_control = new FMRadioHalControl;
+    m_control->start(this);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    while (m_control->tunerState() != QRadioTuner::ActiveState && timer.elapsed() < 5000)
+        QTest::qWait(10);
+
+    return m_control->tunerState() == QRadioTuner::ActiveState;
+}
+
+bool tst_FMRadioHalControl::searchAll(QRadioTuner::SearchMode mode)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_control->searchAllStations(mode);
+    QTest::qWait(0);
+
+    while (m_control->isSearching() && timer.elapsed() < 30000)
+        QTest::qWait(5);
+
+    return !m_control->isSearching();
+}
+
+qreal tst_FMRadioHalControl::latencyBound() const
+{
+    bool ok;
+    int bound = qgetenv("HALRADIO_TEST_LATENCY_MS").toInt(&ok);
+    return ok && bound > 0 ? bound : EVENT_LATENCY_BOUND_MS;
+}
+
+void tst_FMRadioHalControl::report(const char *name, QVector<qint64> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    qreal p50 = latencies.at(latencies.size() / 2) / 1000.0;
+    qreal p99 = latencies.at(latencies.size() * 99 / 100) / 1000.0;
+
+    qDebug("%s latency p50 %.3f ms p99 %.3f ms max %.3f ms", name, p50, p99,
+           latencies.last() / 1000.0);
+
+    QTest::setBenchmarkResult(p50, QTest::WalltimeMilliseconds);
+    QVERIFY2(p99 <= latencyBound(), qPrintable(QString("p99 %1 ms").arg(p99)));
+}
+
+// RADIO_EVENT_ANTENNA callback to antennaConnectedChanged()
+void tst_FMRadioHalControl::eventLatency()
+{
+    QVERIFY(startControl());
+
+    connect(m_control, SIGNAL(antennaConnectedChanged(bool)), this, SLOT(received()));
+    QSignalSpy spy(m_control, SIGNAL(antennaConnectedChanged(bool)));
+
+    QVector<qint64> latencies;
+    bool connected = m_control->isAntennaConnected();
+
+    for (int i = 0; i < 200; ++i) {
+        connected = !connected;
+        FakeRadioHal::sendEvent(antennaEvent(connected));
+        QVERIFY(spy.wait(1000));
+        latencies.append(m_received - FakeRadioHal::lastCallbackTime());
+    }
+
+    report("Event", latencies);
+}
+
+// RADIO_EVENT_TA callback to trafficAnnouncementChanged(), which skips
+// the event queue
+void tst_FMRadioHalControl::announcementLatency()
+{
+    QVERIFY(startControl());
+
+    connect(m_control, SIGNAL(trafficAnnouncementChanged(bool)), this, SLOT(received()));
+    QSignalSpy spy(m_control, SIGNAL(trafficAnnouncementChanged(bool)));
+
+    QVector<qint64> latencies;
+    bool active = false;
+
+    for (int i = 0; i < 200; ++i) {
+        active = !active;
+        FakeRadioHal::sendEvent(onOffEvent(RADIO_EVENT_TA, active));
+        QVERIFY(spy.wait(1000));
+        QCOMPARE(m_control->isTrafficAnnouncement(), active);
+        latencies.append(m_received - FakeRadioHal::lastCallbackTime());
+    }
+
+    report("Announcement", latencies);
+}
+
+void tst_FMRadioHalControl::searchAllStations_data()
+{
+    QTest::addColumn<int>("searchMode");
+
+    QTest::newRow("SearchFast") << static_cast<int>(QRadioTuner::SearchFast);
+    QTest::newRow("SearchGetStationId") << static_cast<int>(QRadioTuner::SearchGetStationId);
+}
+
+// From searchAllStations() to searchingChanged(false) with HAL delays
+// of a typical tuner, every round from an empty station cache.
+void tst_FMRadioHalControl::searchAllStations()
+{
+    QFETCH(int, searchMode);
+
+    qint64 total = 0;
+    const int rounds = 3;
+
+    for (int i = 0; i < rounds; ++i) {
+        if (i > 0)
+            cleanup();
+        init();
+        FakeRadioHal::setDelays(20, 60, 80);
+
+        QVERIFY(startControl());
+        QSignalSpy found(m_control, SIGNAL(stationFound(int, QString)));
+        QSignalSpy searching(m_control, SIGNAL(searchingChanged(bool)));
+
+        QElapsedTimer timer;
+        timer.start();
+        m_control->searchAllStations(static_cast<QRadioTuner::SearchMode>(searchMode));
+
+        while ((searching.isEmpty() || searching.last().at(0).toBool()) && timer.elapsed() < 30000)
+            QTest::qWait(5);
+        total += timer.elapsed();
+
+        QVERIFY(!m_control->isSearching());
+        QCOMPARE(found.count(), testStations().size());
+    }
+
+    QTest::setBenchmarkResult(total / qreal(rounds), QTest::WalltimeMilliseconds);
+}
+
+// Search from cache ranks stations as the search which found them
+void tst_FMRadioHalControl::cachedStations()
+{
+    QVERIFY(startControl());
+    QVERIFY(searchAll(QRadioTuner::SearchFast));
+    QVector<FMRadioStationTable::Station> found = m_control->stationList();
+    QCOMPARE(found.size(), testStations().size());
+
+    m_control->stop(this);
+    delete m_control;
+    m_control = 0;
+
+    // Stations are reported from cache without tuning
+    FakeRadioHal::setStations(QVector<FakeRadioHal::Station>());
+    QVERIFY(startControl());
+    QVERIFY(searchAll(QRadioTuner::SearchFast));
+    QVector<FMRadioStationTable::Station> cached = m_control->stationList();
+
+    QCOMPARE(cached.size(), found.size());
+    for (int i = 0; i < found.size(); ++i) {
+        QCOMPARE(cached.at(i).frequency, found.at(i).frequency);
+        QCOMPARE(cached.at(i).signalStrength, found.at(i).signalStrength);
+        QCOMPARE(cached.at(i).stereo, found.at(i).stereo);
+    }
+}
+
+// Learned timings are kept per HAL, not per band configuration
+void tst_FMRadioHalControl::timingCache()
+{
+    QVERIFY(startControl());
+    QVERIFY(searchAll(QRadioTuner::SearchFast));
+
+    QDir cache(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+               + QStringLiteral("/qtmultimedia-halradio"));
+    QStringList timings = cache.entryList(QStringList() << QStringLiteral("timings-*"), QDir::Files);
+
+    QCOMPARE(timings, QStringList() << QStringLiteral("timings-halradio-tests-fake-tuner-1.0"));
+}
+
+void tst_FMRadioHalControl::rdsAllocations_data()
+{
+    QTest::addColumn<bool>("changing");
+
+    QTest::newRow("unchanged") << false;
+    QTest::newRow("changing") << true;
+}
+
+// Heap allocations of all threads per RDS radio text event, from the
+// callback to the RDS signals. Events are queued in the fake tuner
+// before counting and an antenna event after them marks the end.
+void tst_FMRadioHalControl::rdsAllocations()
+{
+    QFETCH(bool, changing);
+
+    QVERIFY(startControl());
+    m_control->addRdsClient(this);
+
+    QSignalSpy fence(m_control, SIGNAL(antennaConnectedChanged(bool)));
+    bool connected = m_control->isAntennaConnected();
+
+    for (int i = 0; i <= RDS_EVENTS; ++i) {
+        QVector<FakeRadioHal::Text> texts;
+        texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PI, "6201"));
+        texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PS, "YLE 1"));
+        texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_TITLE,
+                                        changing ? QByteArray("Radio text ") + QByteArray::number(i)
+                                                 : QByteArray("Radio text")));
+        // First one is not counted, it sets the station
+        FakeRadioHal::sendMetadata(texts, i == 0 ? 0 : 200);
+    }
+    FakeRadioHal::sendEvent(antennaEvent(!connected), 200);
+
+    QTest::qWait(50);
+    AllocationCounter::start();
+    bool done = fence.wait(5000);
+    int allocations = AllocationCounter::stop();
+    QVERIFY(done);
+
+    qDebug("%d allocations in %d RDS events", allocations, RDS_EVENTS);
+    QTest::setBenchmarkResult(allocations / qreal(RDS_EVENTS), QTest::Events);
+
+    m_control->removeRdsClient(this);
+}
+
+// Packets larger than a metadata buffer, as ones with an image, are
+// still parsed
+void tst_FMRadioHalControl::largeMetadata()
+{
+    QVERIFY(startControl());
+    m_control->addRdsClient(this);
+
+    QVector<FakeRadioHal::Text> texts;
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PI, "6201"));
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PS, "YLE 1"));
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_TITLE, "Radio text"));
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_ALBUM, QByteArray(8192, 'a')));
+    QVERIFY(FakeRadioHal::metadata(texts).size() > int(FMRadioMetadataPool::SlotSize));
+    FakeRadioHal::sendMetadata(texts);
+
+    QTRY_COMPARE(m_control->stationName(), QStringLiteral("YLE 1"));
+    QTRY_COMPARE(m_control->radioText(), QStringLiteral("Radio text"));
+
+    m_control->removeRdsClient(this);
+}
+
+// Muted tuner is reopened without audio, and clients see no state change
+void tst_FMRadioHalControl::mute()
+{
+    QVERIFY(startControl());
+    QCOMPARE(FakeRadioHal::audioTunerCount(), 1);
+
+    QSignalSpy state(m_control, SIGNAL(stateChanged(QRadioTuner::State)));
+
+    m_control->setMuted(true);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 0);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 1);
+    QTRY_VERIFY(m_control->tunerState() == QRadioTuner::ActiveState);
+
+    m_control->setMuted(false);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 1);
+
+    m_control->setVolume(0);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 0);
+    m_control->setVolume(50);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 1);
+
+    QTest::qWait(50);
+    QCOMPARE(state.count(), 0);
+}
+
+// Tuner without audio and RDS clients is closed, and reopened once used
+void tst_FMRadioHalControl::idle()
+{
+    qputenv("HALRADIO_IDLE_TIMEOUT_MS", "100");
+    bool started = startControl();
+    qunsetenv("HALRADIO_IDLE_TIMEOUT_MS");
+    QVERIFY(started);
+
+    m_control->addRdsClient(this);
+    m_control->setMuted(true);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 0);
+    QTest::qWait(300);
+    QCOMPARE(FakeRadioHal::openTunerCount(), 1);
+
+    m_control->removeRdsClient(this);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 0);
+    QVERIFY(m_control->tunerState() == QRadioTuner::ActiveState);
+
+    m_control->addRdsClient(this);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 1);
+    QCOMPARE(FakeRadioHal::audioTunerCount(), 0);
+
+    m_control->removeRdsClient(this);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 0);
+    m_control->setMuted(false);
+    QTRY_COMPARE(FakeRadioHal::audioTunerCount(), 1);
+}
+
+// Second tuner is used only while background scan is enabled
+void tst_FMRadioHalControl::backgroundScan()
+{
+    FakeRadioHal::setTunerCount(2);
+    QVERIFY(startControl());
+    QVERIFY(m_control->isBackgroundScanSupported());
+    QCOMPARE(FakeRadioHal::openTunerCount(), 1);
+
+    m_control->setBackgroundScanEnabled(true);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 2);
+    QCOMPARE(FakeRadioHal::audioTunerCount(), 1);
+
+    m_control->setBackgroundScanEnabled(false);
+    QTRY_COMPARE(FakeRadioHal::openTunerCount(), 1);
+}
+
+// History is kept until the last client disables it
+void tst_FMRadioHalControl::rdsHistoryClients()
+{
+    QVERIFY(startControl());
+
+    QObject other;
+    m_control->addRdsClient(this);
+    m_control->setRdsHistoryEnabled(this, true);
+    m_control->setRdsHistoryEnabled(&other, true);
+
+    QSignalSpy changed(m_control, SIGNAL(rdsHistoryChanged()));
+    QVector<FakeRadioHal::Text> texts;
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_RDS_PI, "6201"));
+    texts.append(FakeRadioHal::Text(RADIO_METADATA_KEY_TITLE, "Song"));
+    FakeRadioHal::sendMetadata(texts);
+    QVERIFY(changed.wait(1000));
+    QCOMPARE(m_control->rdsHistory().count(), 1);
+
+    m_control->setRdsHistoryEnabled(&other, false);
+    QVERIFY(m_control->isRdsHistoryEnabled());
+    QCOMPARE(m_control->rdsHistory().count(), 1);
+
+    // Disabling again by the same client changes nothing
+    m_control->setRdsHistoryEnabled(&other, false);
+    QCOMPARE(m_control->rdsHistory().count(), 1);
+
+    m_control->setRdsHistoryEnabled(this, false);
+    QVERIFY(!m_control->isRdsHistoryEnabled());
+    QCOMPARE(m_control->rdsHistory().count(), 0);
+
+    m_control->removeRdsClient(this);
+}
+
+// Replays HALRADIO_TEST_TRACE recorded with HALRADIO_RECORD, at
+// HALRADIO_TEST_TRACE_SPEED times the recorded speed, 0 as fast as
+// possible.
+void tst_FMRadioHalControl::replay()
+{
+    QString path = QString::fromLocal8Bit(qgetenv("HALRADIO_TEST_TRACE"));
+    if (path.isEmpty())
+        QSKIP("HALRADIO_TEST_TRACE not set");
+
+    bool ok;
+    double speed = qgetenv("HALRADIO_TEST_TRACE_SPEED").toDouble(&ok);
+    int events = FakeRadioHal::setReplay(path, ok && speed >= 0 ? speed : 1.0);
+    QVERIFY(events >= 0);
+
+    int before = FakeRadioHal::callbackCount();
+    QElapsedTimer timer;
+    timer.start();
+
+    m_control = new FMRadioHalControl;
+    m_control->addRdsClient(this);
+    m_control->start(this);
+
+    QTRY_COMPARE_WITH_TIMEOUT(FakeRadioHal::callbackCount() - before, events, 600000);
+    QTest::qWait(100);
+    QTest::setBenchmarkResult(timer.elapsed(), QTest::WalltimeMilliseconds);
+
+    m_control->removeRdsClient(this);
+}
+
+QTEST_GUILESS_MAIN(tst_FMRadioHalControl)
+
+#include "tst_fmradiohalcontrol.moc"
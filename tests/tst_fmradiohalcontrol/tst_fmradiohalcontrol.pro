@@ -0,0 +1,5 @@
+TARGET = tst_fmradiohalcontrol
+
+include(../common/halradio.pri)
+
+SOURCES += tst_fmradiohalcontrol.cpp
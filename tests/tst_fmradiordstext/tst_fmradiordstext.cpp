@@ -0,0 +1,151 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "fmradiordstext.h"
+#include "fmradiordshistory.h"
+
+#include <QRegExp>
+#include <QtTest>
+
+// RDS text handling before FMRadioRdsText, from handleMetadata()
+static bool regExpUpdate(QString *value, const char *text)
+{
+    static const QRegExp regExp("[^a-zA-Z0-9 -_,;.:!#%&/()=?@£$+]");
+    QString str = QString::fromUtf8(text);
+    str = str.remove(regExp).trimmed();
+
+    if (str == *value)
+        return false;
+
+    *value = str;
+    return true;
+}
+
+class tst_FMRadioRdsText : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sanitize_data();
+    void sanitize();
+    void benchmark_data();
+    void benchmark();
+    void historyTruncation();
+};
+
+static void addTexts()
+{
+    QTest::addColumn<QByteArray>("text");
+
+    QTest::newRow("name") << QByteArray("YLE 1   ");
+    QTest::newRow("text") << QByteArray("Now playing: Artist - Song (2018) #1 @ 98.5 MHz!");
+    QTest::newRow("filtered") << QByteArray("\x01Radio\ttext \xc3\xa4\xc3\xb6 {with} [junk] ~\x7f");
+    QTest::newRow("pound") << QByteArray("Tickets \xc2\xa3" "10 & $12");
+    QTest::newRow("spaces") << QByteArray("                                ");
+    QTest::newRow("long") << QByteArray(64, 'x');
+}
+
+void tst_FMRadioRdsText::sanitize_data()
+{
+    addTexts();
+}
+
+// Same result as the QRegExp it replaced
+void tst_FMRadioRdsText::sanitize()
+{
+    QFETCH(QByteArray, text);
+
+    QString expected;
+    regExpUpdate(&expected, text.constData());
+
+    FMRadioRdsText rds;
+    rds.update(text.constData(), text.size());
+    QCOMPARE(rds.toString(), expected);
+
+    QVERIFY(!rds.update(text.constData(), text.size()));
+}
+
+void tst_FMRadioRdsText::benchmark_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<bool>("regExp");
+
+    QList<QByteArray> rows;
+    rows << "name" << "text" << "filtered";
+
+    QByteArray texts[] = {
+        QByteArray("YLE 1   "),
+        QByteArray("Now playing: Artist - Song (2018) #1 @ 98.5 MHz!"),
+        QByteArray("\x01Radio\ttext \xc3\xa4\xc3\xb6 {with} [junk] ~\x7f")
+    };
+
+    for (int i = 0; i < rows.size(); ++i) {
+        QTest::newRow(QByteArray(rows.at(i) + " regexp").constData()) << texts[i] << true;
+        QTest::newRow(QByteArray(rows.at(i) + " sanitizer").constData()) << texts[i] << false;
+    }
+}
+
+// Unchanged text, which is what the HAL sends most of the time
+void tst_FMRadioRdsText::benchmark()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(bool, regExp);
+
+    if (regExp) {
+        QString value;
+        QBENCHMARK {
+            regExpUpdate(&value, text.constData());
+        }
+    } else {
+        FMRadioRdsText rds;
+        QBENCHMARK {
+            rds.update(text.constData(), text.size());
+        }
+    }
+}
+
+// Texts longer than a history field are cut at a character boundary
+void tst_FMRadioRdsText::historyTruncation()
+{
+    FMRadioRdsText stationId;
+    FMRadioRdsText stationName;
+    FMRadioRdsText title;
+    FMRadioRdsText artist;
+
+    QByteArray name = QByteArray(22, 'n') + "\xc2\xa3";
+    QByteArray band = QByteArray(62, 'a') + "\xc2\xa3";
+    stationId.update("6201", 4);
+    stationName.update(name.constData(), name.size());
+    title.update("Radio text", 10);
+    artist.update(band.constData(), band.size());
+
+    FMRadioRdsHistory history;
+    QVERIFY(history.add(0, 87500, stationId, stationName, title, artist));
+    const FMRadioRdsHistory::Entry &entry = history.at(0);
+
+    QCOMPARE(FMRadioRdsHistory::text(entry.stationName, sizeof(entry.stationName)),
+             QString(22, QLatin1Char('n')));
+    QCOMPARE(FMRadioRdsHistory::text(entry.artist, sizeof(entry.artist)),
+             QString(62, QLatin1Char('a')));
+}
+
+QTEST_APPLESS_MAIN(tst_FMRadioRdsText)
+
+#include "tst_fmradiordstext.moc"
@@ -0,0 +1,14 @@
+TARGET = tst_fmradiordstext
+
+QT = core testlib
+CONFIG += testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += tst_fmradiordstext.cpp \
+           $$PWD/../../fmradiordshistory.cpp \
+           $$PWD/../../fmradiordstext.cpp
+
+HEADERS += $$PWD/../../fmradiordshistory.h \
+           $$PWD/../../fmradiordstext.h
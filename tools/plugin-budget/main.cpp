@@ -0,0 +1,119 @@
+/*
+  Copyright (C) 2018 Jolla Ltd
+  Contact: Juho Hämäläinen <juho.hamalainen@jolla.com>
+  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Reports plugin size and the time QPluginLoader takes to load it,
+// create a radio service and have its tuner active, and fails if either
+// is over budget. The HAL is opened in a thread after create(), so the
+// time until the tuner is active is what clients wait for.
+//
+// Usage: plugin-budget <plugin.so> <max bytes> <max total ms>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMediaService>
+#include <QMediaServiceProviderPlugin>
+#include <QPluginLoader>
+#include <QRadioTunerControl>
+#include <QTimer>
+
+#include <stdio.h>
+
+#define TUNER_TIMEOUT_MS    (10 * 1000)
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+
+    if (args.size() != 4) {
+        fprintf(stderr, "Usage: %s <plugin> <max bytes> <max ms>\n", argv[0]);
+        return 2;
+    }
+
+    QFileInfo info(args.at(1));
+    qint64 maxSize = args.at(2).toLongLong();
+    qint64 maxTime = args.at(3).toLongLong();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QPluginLoader loader(info.absoluteFilePath());
+    QMediaServiceProviderFactoryInterface *factory
+            = qobject_cast<QMediaServiceProviderFactoryInterface*>(loader.instance());
+    qint64 loadTime = timer.nsecsElapsed();
+
+    if (!factory) {
+        fprintf(stderr, "Failed to load %s: %s\n", qPrintable(info.filePath()),
+                qPrintable(loader.errorString()));
+        return 1;
+    }
+
+    timer.restart();
+    QMediaService *service = factory->create(QLatin1String(Q_MEDIASERVICE_RADIO));
+    qint64 createTime = timer.nsecsElapsed();
+
+    if (!service) {
+        fprintf(stderr, "Failed to create radio service\n");
+        return 1;
+    }
+
+    QRadioTunerControl *tuner = qobject_cast<QRadioTunerControl*>(
+                service->requestControl(QRadioTunerControl_iid));
+    if (!tuner) {
+        fprintf(stderr, "No radio tuner control\n");
+        factory->release(service);
+        return 1;
+    }
+
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    timeout.start(TUNER_TIMEOUT_MS);
+
+    tuner->start();
+    while (tuner->state() != QRadioTuner::ActiveState && timeout.isActive())
+        app.processEvents(QEventLoop::WaitForMoreEvents);
+    qint64 tunerTime = timer.nsecsElapsed() - createTime;
+    bool active = tuner->state() == QRadioTuner::ActiveState;
+
+    tuner->stop();
+    service->releaseControl(tuner);
+    factory->release(service);
+
+    if (!active) {
+        fprintf(stderr, "Tuner not active in %d ms\n", TUNER_TIMEOUT_MS);
+        return 1;
+    }
+
+    qint64 total = (loadTime + createTime + tunerTime) / 1000000;
+
+    printf("size:   %lld bytes (budget %lld)\n", info.size(), maxSize);
+    printf("load:   %.3f ms\n", loadTime / 1000000.0);
+    printf("create: %.3f ms\n", createTime / 1000000.0);
+    printf("tuner:  %.3f ms\n", tunerTime / 1000000.0);
+    printf("total:  %lld ms (budget %lld)\n", total, maxTime);
+
+    if (info.size() > maxSize || total > maxTime) {
+        fprintf(stderr, "Plugin over budget.\n");
+        return 1;
+    }
+
+    return 0;
+}
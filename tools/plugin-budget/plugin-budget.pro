@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = plugin-budget
+QT = core multimedia
+CONFIG += console
+CONFIG -= app_bundle
+
+SOURCES += main.cpp